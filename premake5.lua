@@ -21,6 +21,51 @@ workspace "ClassicalAtom"
 		include "3rdParty/RenderingUtilities"
 	group ""
 
+-- The simulation itself, without any windowing or rendering, shared by the app and the headless
+-- executable
+project "Physics"
+	kind "StaticLib"
+	language "C++"
+
+	cppdialect "C++20"
+
+	flags "MultiProcessorCompile"
+
+	targetdir ("%{wks.location}/build/bin/%{prj.name}")
+	objdir ("%{wks.location}/build/bin-int/%{prj.name}")
+
+	filter "configurations:Debug"
+		symbols "On"
+	filter {}
+	
+	filter "configurations:Release"
+		optimize "On"
+	filter {}
+
+	files {
+		"src/Physics/**.h",
+		"src/Physics/**.cpp"
+	}
+
+	-- The vector pair kernels are compiled for their instruction set only, the rest of the
+	-- program stays portable and picks a kernel at runtime
+	filter { "files:src/Physics/PairKernelsSse4.cpp", "toolset:gcc or clang" }
+		buildoptions "-msse4.1"
+	filter { "files:src/Physics/PairKernelsAvx2.cpp", "toolset:msc*" }
+		buildoptions "/arch:AVX2"
+	filter { "files:src/Physics/PairKernelsAvx2.cpp", "toolset:gcc or clang" }
+		buildoptions { "-mavx2", "-mfma" }
+	filter { "files:src/Physics/PairKernelsAvx512.cpp", "toolset:msc*" }
+		buildoptions "/arch:AVX512"
+	filter { "files:src/Physics/PairKernelsAvx512.cpp", "toolset:gcc or clang" }
+		buildoptions "-mavx512f"
+	filter {}
+
+	includedirs {
+		"src",
+		"3rdParty/glm"
+	}
+
 project "ClassicalAtom"
 	kind "ConsoleApp"
 	language "C++"
@@ -41,8 +86,7 @@ project "ClassicalAtom"
 	filter {}
 
 	files {
-		"src/**.h",
-		"src/**.cpp"
+		"src/main.cpp"
 	}
 
 	defines {
@@ -70,6 +114,7 @@ project "ClassicalAtom"
     }
 
 	links {
+		"Physics",
         "glew32s",
         "opengl32",
         "glfw3",
@@ -78,3 +123,71 @@ project "ClassicalAtom"
 		"assimp",
 		"RenderingUtilities"
 	}
+
+-- Runs atoms and ensembles from the command line, for machines without a display
+project "ClassicalAtomHeadless"
+	kind "ConsoleApp"
+	language "C++"
+
+	cppdialect "C++20"
+
+	flags "MultiProcessorCompile"
+
+	targetdir ("%{wks.location}/build/bin/%{prj.name}")
+	objdir ("%{wks.location}/build/bin-int/%{prj.name}")
+
+	filter "configurations:Debug"
+		symbols "On"
+	filter {}
+	
+	filter "configurations:Release"
+		optimize "On"
+	filter {}
+
+	files {
+		"src/Headless/**.h",
+		"src/Headless/**.cpp"
+	}
+
+	includedirs {
+		"src",
+		"3rdParty/glm"
+	}
+
+	links {
+		"Physics"
+	}
+
+-- Times the force kernels and integrator steps over a range of particle counts
+project "ClassicalAtomBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+
+	cppdialect "C++20"
+
+	flags "MultiProcessorCompile"
+
+	targetdir ("%{wks.location}/build/bin/%{prj.name}")
+	objdir ("%{wks.location}/build/bin-int/%{prj.name}")
+
+	filter "configurations:Debug"
+		symbols "On"
+	filter {}
+	
+	filter "configurations:Release"
+		optimize "On"
+	filter {}
+
+	files {
+		"src/Benchmark/**.h",
+		"src/Benchmark/**.cpp"
+	}
+
+	includedirs {
+		"src",
+		"3rdParty/glm"
+	}
+
+	links {
+		"Physics"
+	}
@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Physics/BarnesHut.h"
+#include "Physics/BlockTimesteps.h"
+#include "Physics/Coulomb.h"
+#include "Physics/CpuFeatures.h"
+#include "Physics/FastMultipole.h"
+#include "Physics/Hermite.h"
+#include "Physics/Integrator.h"
+#include "Physics/Nuclear.h"
+#include "Physics/ParticleMeshEwald.h"
+#include "Physics/PerfCounters.h"
+#include "Physics/ReplicaBatch.h"
+#include "Physics/Scene.h"
+#include "Physics/SmallAtom.h"
+#include "Physics/ThreadPool.h"
+
+// Times every force kernel and integrator step over N = 4, 16, 64, ... particles and reports the
+// median time per call and the pair interactions per second, optionally writing the results as
+// JSON and comparing them against a saved baseline.
+//
+// Pairs per second always counts the pairs a direct sum over the same particles would evaluate,
+// so the approximate solvers show how many direct pairs they stand in for per second.
+
+struct Options {
+    int maxN{ 1 << 20 };
+    std::string filter;
+
+    int threads{ (int)std::thread::hardware_concurrency() };
+
+    int warmup{ 2 };
+    int repetitions{ 5 };
+    double minTime{ 0.05 };
+
+    // Benchmarks whose direct sums would evaluate more pairs per call are skipped
+    double maxPairs{ 2.0e9 };
+
+    std::string output;
+    std::string baseline;
+    double threshold{ 0.1 };
+
+    bool counters{ false };
+};
+
+// Particles a benchmark acts on: charged only, nucleons only, or a whole atom
+enum class Population {
+    Charged,
+    Nucleons,
+    Atom
+};
+
+// Everything the benchmarks need at one N, rebuilt for every N
+struct Fixture {
+    explicit Fixture(ThreadPool& threadPool) : pool{ threadPool } { }
+
+    ThreadPool& pool;
+
+    PhysicsState initial;
+    PhysicsState state;
+
+    ForceAccumulator accumulator;
+    Vec3Array coulombForces;
+    Vec3Array nuclearForces;
+    Vec3Array forces;
+    Vec3Array field;
+
+    BarnesHutTree barnesHutTree;
+    FastMultipole fastMultipole;
+    ParticleMeshEwald particleMeshEwald;
+    NuclearCellList nuclearCellList;
+    NuclearNeighbourList nuclearNeighbourList;
+
+    BlockTimesteps blockTimesteps;
+    HermiteIntegrator hermite;
+    SmallAtom smallAtom;
+    ReplicaBatch replicaBatch;
+
+    SimdLevel simdLevel{ SimdLevel::Scalar };
+
+    void ComputeForces() {
+        Particles& particles = state.particles;
+
+        DirectForces(particles, accumulator, pool, simdLevel, coulombForces, nuclearForces, forces);
+    }
+
+    // Forces on the sorted targets only, as the app does for block time steps
+    void ComputeForcesOn(const int* targets, int targetCount) {
+        Particles& particles = state.particles;
+
+        if (2 * targetCount > particles.Size()) {
+            ComputeForces();
+            return;
+        }
+
+        const int chargedEnd = particles.ChargedEnd();
+        const int nucleonBegin = particles.NucleonBegin();
+
+        const int chargedTargetCount = (int)(std::lower_bound(targets, targets + targetCount, chargedEnd) - targets);
+        const int nucleonTargetBegin = (int)(std::lower_bound(targets, targets + targetCount, nucleonBegin) - targets);
+
+        DirectCoulombForcesOn(particles, 0, chargedEnd, targets, chargedTargetCount, pool, simdLevel, coulombForces);
+        NuclearForcesOn(particles, nucleonBegin, particles.Size(), targets + nucleonTargetBegin, targetCount - nucleonTargetBegin, false, 0.0f, pool, simdLevel, nuclearForces);
+
+        for (int t = 0; t < targetCount; ++t) {
+            const int i = targets[t];
+
+            glm::vec3 force{ 0.0f };
+            if (i < chargedEnd) force += coulombForces.Get(i);
+            if (i >= nucleonBegin) force += nuclearForces.Get(i);
+
+            forces.Set(i, force);
+        }
+    }
+};
+
+struct Benchmark {
+    std::string name;
+    Population population;
+
+    // Largest N the benchmark runs at: the capacity of the fixed size paths, and for the
+    // approximate solvers, which --max-pairs does not limit, about a second per call on one thread
+    int maxN;
+
+    // Called before every repetition, outside the timing, after the particles have been reset
+    std::function<void(Fixture&)> prepare;
+    std::function<void(Fixture&)> run;
+};
+
+struct Result {
+    std::string name;
+    int n;
+    double nsPerCall;
+    double minNs;
+    double maxNs;
+    double pairsPerSecond;
+    int iterations;
+
+    // Hardware counts per step, only when they could be read
+    bool counted;
+    std::array<double, PerfCounterCount> counts;
+};
+
+void PrintUsage() {
+    std::cout << "Usage: ClassicalAtomBenchmark [options]\n"
+        "  --max-n N          largest particle count, N runs over 4, 16, 64, ... (1048576)\n"
+        "  --filter TEXT      only run benchmarks whose name contains TEXT\n"
+        "  --threads N        threads in the pool (all)\n"
+        "  --warmup N         untimed calls before timing (2)\n"
+        "  --repetitions N    timed repetitions, the median is reported (5)\n"
+        "  --min-time S       shortest repetition in seconds, short calls are repeated to fill it (0.05)\n"
+        "  --max-pairs P      skip sizes whose direct sums evaluate more pairs per call (2e9),\n"
+        "                     the approximate solvers stop at fixed sizes of their own\n"
+        "  --output PATH      write the results as JSON\n"
+        "  --baseline PATH    compare against results written by --output earlier\n"
+        "  --threshold X      slowdown against the baseline reported as a regression (0.1)\n"
+        "  --counters         report hardware counters per step, of the calling thread only (Linux)\n";
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view option = argv[i];
+
+        if (option == "--help") return false;
+
+        if (option == "--counters") {
+            options.counters = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cout << "ERROR: Missing value for " << option << std::endl;
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        if (option == "--max-n") options.maxN = std::atoi(value);
+        else if (option == "--filter") options.filter = value;
+        else if (option == "--threads") options.threads = std::max(std::atoi(value), 1);
+        else if (option == "--warmup") options.warmup = std::max(std::atoi(value), 0);
+        else if (option == "--repetitions") options.repetitions = std::max(std::atoi(value), 1);
+        else if (option == "--min-time") options.minTime = std::atof(value);
+        else if (option == "--max-pairs") options.maxPairs = std::atof(value);
+        else if (option == "--output") options.output = value;
+        else if (option == "--baseline") options.baseline = value;
+        else if (option == "--threshold") options.threshold = std::atof(value);
+        else {
+            std::cout << "ERROR: Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Pairs the direct sums evaluate per force evaluation
+double DirectPairCount(const Particles& particles) {
+    double charged = particles.ChargedEnd();
+    double nucleons = particles.Size() - particles.NucleonBegin();
+
+    return 0.5 * charged * (charged - 1.0) + 0.5 * nucleons * (nucleons - 1.0);
+}
+
+PhysicsState MakeState(Population population, int n) {
+    PhysicsState state{ };
+
+    switch (population) {
+        case Population::Charged: AddToState(state, 0, n / 2, n - n / 2); break;
+        case Population::Nucleons: AddToState(state, n - n / 2, n / 2, 0); break;
+        case Population::Atom: AddToState(state, n / 3, n / 3, n - 2 * (n / 3)); break;
+    }
+
+    return state;
+}
+
+std::vector<Benchmark> MakeBenchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    const int unlimited = 1 << 30;
+    const float dt = 1.0e-5f;
+
+    auto nothing = [](Fixture&) { };
+
+    // Sizes where one call of an approximate solver takes about a second on one thread, they grow
+    // roughly linearly from there
+    const int barnesHutMaxN = 1 << 18;
+    const int fastMultipoleMaxN = 1 << 16;
+    const int particleMeshEwaldMaxN = 1 << 16;
+    const int cellListMaxN = 1 << 18;
+    const int neighbourListMaxN = 1 << 14;
+
+    for (int level = 0; level <= (int)DetectSimdLevel(); ++level) {
+        const SimdLevel simdLevel = (SimdLevel)level;
+        const std::string suffix = std::string{ "/" } + SimdLevelName(simdLevel);
+
+        benchmarks.push_back({ "coulomb/direct" + suffix, Population::Charged, unlimited, nothing, [=](Fixture& f) {
+            const Particles& particles = f.state.particles;
+            DirectCoulombForces(particles, 0, particles.ChargedEnd(), f.accumulator, f.pool, simdLevel, f.coulombForces);
+        } });
+
+        benchmarks.push_back({ "nuclear/direct" + suffix, Population::Nucleons, unlimited, nothing, [=](Fixture& f) {
+            const Particles& particles = f.state.particles;
+            NuclearForces(particles, particles.NucleonBegin(), particles.Size(), false, 0.0f, f.accumulator, f.pool, simdLevel, f.nuclearForces);
+        } });
+    }
+
+    benchmarks.push_back({ "coulomb/barnes-hut", Population::Charged, barnesHutMaxN, nothing, [](Fixture& f) {
+        const Particles& particles = f.state.particles;
+        BarnesHutCoulombField(f.barnesHutTree, particles, 0, particles.ChargedEnd(), 0.5f, f.pool, f.field);
+    } });
+
+    benchmarks.push_back({ "coulomb/fast-multipole", Population::Charged, fastMultipoleMaxN, nothing, [](Fixture& f) {
+        const Particles& particles = f.state.particles;
+        f.fastMultipole.Evaluate(particles, 0, particles.ChargedEnd(), f.pool, f.field);
+    } });
+
+    benchmarks.push_back({ "coulomb/particle-mesh-ewald", Population::Charged, particleMeshEwaldMaxN, nothing, [](Fixture& f) {
+        const Particles& particles = f.state.particles;
+        const float boxSize = (float)LatticeSize(particles.Size());
+
+        f.particleMeshEwald.Evaluate(particles, 0, particles.ChargedEnd(), boxSize, f.pool, f.field);
+    } });
+
+    benchmarks.push_back({ "nuclear/cell-list", Population::Nucleons, cellListMaxN, nothing, [](Fixture& f) {
+        const Particles& particles = f.state.particles;
+        f.nuclearCellList.Evaluate(particles, particles.NucleonBegin(), particles.Size(), false, 0.0f, f.accumulator, f.pool, f.simdLevel, f.nuclearForces);
+    } });
+
+    benchmarks.push_back({ "nuclear/neighbour-list", Population::Nucleons, neighbourListMaxN, [](Fixture& f) { f.nuclearNeighbourList.Invalidate(); }, [](Fixture& f) {
+        const Particles& particles = f.state.particles;
+        f.nuclearNeighbourList.Evaluate(particles, particles.NucleonBegin(), particles.Size(), false, 0.0f, f.accumulator, f.pool, f.simdLevel, f.nuclearForces);
+    } });
+
+    auto computeForces = [](Fixture& f) { f.ComputeForces(); };
+
+    benchmarks.push_back({ "step/velocity-verlet", Population::Atom, unlimited, computeForces, [=](Fixture& f) {
+        Particles& particles = f.state.particles;
+
+        Kick(particles, 0, particles.Size(), f.forces, 0.5f * dt, f.pool);
+        Drift(particles, 0, particles.Size(), dt, false, 0.0f, f.pool);
+
+        f.ComputeForces();
+
+        Kick(particles, 0, particles.Size(), f.forces, 0.5f * dt, f.pool);
+    } });
+
+    benchmarks.push_back({ "step/block-timesteps", Population::Atom, unlimited, [](Fixture& f) { f.ComputeForces(); f.blockTimesteps.Invalidate(); }, [=](Fixture& f) {
+        f.blockTimesteps.Step(f.state.particles, dt, false, 0.0f, f.forces, f.pool, [&](const int* targets, int targetCount) {
+            f.ComputeForcesOn(targets, targetCount);
+        });
+    } });
+
+    benchmarks.push_back({ "step/respa", Population::Atom, unlimited, computeForces, [=](Fixture& f) {
+        Particles& particles = f.state.particles;
+
+        const int innerSteps = 4;
+        const float innerDt = dt / innerSteps;
+
+        Kick(particles, 0, particles.Size(), f.coulombForces, 0.5f * dt, f.pool);
+
+        for (int step = 0; step < innerSteps; ++step) {
+            Kick(particles, 0, particles.Size(), f.nuclearForces, 0.5f * innerDt, f.pool);
+            Drift(particles, 0, particles.Size(), innerDt, false, 0.0f, f.pool);
+
+            NuclearForces(particles, particles.NucleonBegin(), particles.Size(), false, 0.0f, f.accumulator, f.pool, f.simdLevel, f.nuclearForces);
+
+            Kick(particles, 0, particles.Size(), f.nuclearForces, 0.5f * innerDt, f.pool);
+        }
+
+        DirectCoulombForces(particles, 0, particles.ChargedEnd(), f.accumulator, f.pool, f.simdLevel, f.coulombForces);
+
+        Kick(particles, 0, particles.Size(), f.coulombForces, 0.5f * dt, f.pool);
+    } });
+
+    benchmarks.push_back({ "step/hermite", Population::Atom, unlimited, [](Fixture& f) { f.hermite.Invalidate(); }, [=](Fixture& f) {
+        f.hermite.Step(f.state.particles, dt, f.pool);
+    } });
+
+    // Atoms of up to 16 particles of each group fit, so 16 is the largest N on the grid
+    benchmarks.push_back({ "step/small-atom", Population::Atom, 16, [](Fixture& f) { f.smallAtom.Load(f.state.particles); }, [=](Fixture& f) {
+        f.smallAtom.Step(dt, 1);
+    } });
+
+    // One call steps a register's worth of copies, timed per replica step
+    benchmarks.push_back({ "step/replica-lane", Population::Atom, 64, [](Fixture& f) {
+        const Particles* replicas[ReplicaBatch::MaxLaneCount];
+        for (const Particles*& replica : replicas) replica = &f.state.particles;
+
+        f.replicaBatch.Load(replicas, ReplicaBatch::LaneCount(f.simdLevel), f.simdLevel);
+    }, [=](Fixture& f) {
+        f.replicaBatch.Step(dt, 1);
+    } });
+
+    return benchmarks;
+}
+
+Result RunBenchmark(const Benchmark& benchmark, Fixture& fixture, int n, const Options& options, const PerfCounters& counters) {
+    using Clock = std::chrono::steady_clock;
+
+    auto reset = [&]() {
+        fixture.state = fixture.initial;
+        benchmark.prepare(fixture);
+    };
+
+    auto time = [&](int iterations) {
+        const auto start = Clock::now();
+
+        for (int i = 0; i < iterations; ++i) {
+            benchmark.run(fixture);
+        }
+
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    reset();
+
+    for (int i = 0; i < options.warmup; ++i) {
+        benchmark.run(fixture);
+    }
+
+    // Double the calls per repetition until a repetition is long enough to time reliably
+    int iterations = 1;
+
+    while (iterations < (1 << 24)) {
+        reset();
+
+        if (time(iterations) >= options.minTime) break;
+
+        iterations *= 2;
+    }
+
+    std::vector<double> samples;
+    PerfValues counts{ };
+    int countedRepetitions = 0;
+
+    for (int repetition = 0; repetition < options.repetitions; ++repetition) {
+        reset();
+
+        PerfValues before{ };
+        PerfValues after{ };
+
+        const bool readBefore = counters.Read(before);
+        samples.push_back(time(iterations) * 1.0e9 / iterations);
+        const bool readAfter = counters.Read(after);
+
+        // Repetitions whose counters could not be read are left out of the counts
+        if (!readBefore || !readAfter) continue;
+
+        for (int i = 0; i < PerfCounterCount; ++i) {
+            counts[i] += after[i] > before[i] ? after[i] - before[i] : 0;
+        }
+
+        ++countedRepetitions;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    // The replica kernels advance a whole register of atoms per call
+    const int atomsPerCall = benchmark.name == "step/replica-lane" ? fixture.replicaBatch.GetLaneCount() : 1;
+
+    Result result{ };
+    result.name = benchmark.name;
+    result.n = n;
+    result.nsPerCall = samples[samples.size() / 2] / atomsPerCall;
+    result.minNs = samples.front() / atomsPerCall;
+    result.maxNs = samples.back() / atomsPerCall;
+    result.pairsPerSecond = DirectPairCount(fixture.initial.particles) / (result.nsPerCall * 1.0e-9);
+    result.iterations = iterations;
+    result.counted = countedRepetitions > 0;
+
+    for (int i = 0; i < PerfCounterCount; ++i) {
+        result.counts[i] = result.counted ? (double)counts[i] / ((double)iterations * countedRepetitions * atomsPerCall) : 0.0;
+    }
+
+    return result;
+}
+
+void WriteJson(const std::string& path, const std::vector<Result>& results, const Options& options) {
+    std::ofstream file{ path };
+
+    if (!file) {
+        std::cout << "ERROR: Could not open " << path << std::endl;
+        return;
+    }
+
+    file << std::setprecision(9);
+
+    // One result per line, which is all ReadBaseline relies on
+    file << "{\n";
+    file << "  \"simd\": \"" << SimdLevelName(DetectSimdLevel()) << "\",\n";
+    file << "  \"threads\": " << options.threads << ",\n";
+    file << "  \"results\": [\n";
+
+    for (int i = 0; i < (int)results.size(); ++i) {
+        const Result& result = results[i];
+
+        file << "    { \"name\": \"" << result.name << "\", \"n\": " << result.n << ", \"ns_per_step\": " << result.nsPerCall
+            << ", \"min_ns\": " << result.minNs << ", \"max_ns\": " << result.maxNs << ", \"pairs_per_second\": " << result.pairsPerSecond
+            << ", \"iterations\": " << result.iterations;
+
+        if (result.counted) {
+            for (int c = 0; c < PerfCounterCount; ++c) {
+                file << ", \"" << PerfCounterKey((PerfCounter)c) << "\": " << result.counts[c];
+            }
+        }
+
+        file << " }" << (i + 1 < (int)results.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+}
+
+// Value following "key": on a line, empty if the key is missing
+std::string JsonField(const std::string& line, const std::string& key) {
+    const std::string pattern = "\"" + key + "\": ";
+
+    size_t start = line.find(pattern);
+    if (start == std::string::npos) return { };
+
+    start += pattern.size();
+
+    if (line[start] == '"') {
+        size_t end = line.find('"', start + 1);
+        return line.substr(start + 1, end - start - 1);
+    }
+
+    size_t end = line.find_first_of(",}", start);
+    return line.substr(start, end - start);
+}
+
+// ns per step of every benchmark and N in a file written by WriteJson
+std::map<std::pair<std::string, int>, double> ReadBaseline(const std::string& path) {
+    std::map<std::pair<std::string, int>, double> baseline;
+
+    std::ifstream file{ path };
+
+    if (!file) {
+        std::cout << "ERROR: Could not open " << path << std::endl;
+        return baseline;
+    }
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        std::string name = JsonField(line, "name");
+        std::string n = JsonField(line, "n");
+        std::string ns = JsonField(line, "ns_per_step");
+
+        if (name.empty() || n.empty() || ns.empty()) continue;
+
+        baseline[{ name, std::atoi(n.c_str()) }] = std::atof(ns.c_str());
+    }
+
+    return baseline;
+}
+
+int main(int argc, char** argv) {
+    Options options{ };
+
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::map<std::pair<std::string, int>, double> baseline;
+
+    if (!options.baseline.empty()) {
+        baseline = ReadBaseline(options.baseline);
+        if (baseline.empty()) return 1;
+    }
+
+    ThreadPool pool{ options.threads };
+
+    PerfCounters counters{ };
+
+    if (options.counters && !counters.Open()) {
+        std::cout << "ERROR: Could not open the hardware counters, perf_event_open is unavailable or not permitted." << std::endl;
+    }
+
+    const std::vector<Benchmark> benchmarks = MakeBenchmarks();
+    std::vector<Result> results;
+
+    int regressions = 0;
+
+    std::cout << "Instruction set " << SimdLevelName(DetectSimdLevel()) << ", " << options.threads << " threads\n\n";
+    std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(9) << "N" << std::setw(16) << "ns/step" << std::setw(16) << "pairs/s";
+    if (counters.IsOpen()) std::cout << std::setw(12) << "cycles" << std::setw(7) << "IPC" << std::setw(10) << "L1D miss" << std::setw(10) << "LLC miss" << std::setw(10) << "br miss";
+    if (!baseline.empty()) std::cout << std::setw(12) << "vs base";
+    std::cout << "\n";
+
+    for (int n = 4; n <= options.maxN; n *= 4) {
+        for (Population population : { Population::Charged, Population::Nucleons, Population::Atom }) {
+            Fixture fixture{ pool };
+            fixture.simdLevel = DetectSimdLevel();
+            fixture.initial = MakeState(population, n);
+
+            // The direct sums and the steps built on them visit every pair, so sizes past the pair
+            // budget would take too long. The approximate solvers stop at their own maxN instead
+            const bool direct = DirectPairCount(fixture.initial.particles) <= options.maxPairs;
+
+            for (const Benchmark& benchmark : benchmarks) {
+                if (benchmark.population != population || n > benchmark.maxN) continue;
+                if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) continue;
+
+                const bool approximate = benchmark.name.find("/direct") == std::string::npos && benchmark.name.rfind("step/", 0) != 0;
+                if (!direct && !approximate) continue;
+
+                Result result = RunBenchmark(benchmark, fixture, n, options, counters);
+                results.push_back(result);
+
+                std::cout << std::left << std::setw(28) << result.name << std::right << std::setw(9) << n
+                    << std::setw(16) << std::fixed << std::setprecision(1) << result.nsPerCall
+                    << std::setw(16) << std::scientific << std::setprecision(3) << result.pairsPerSecond << std::defaultfloat;
+
+                if (result.counted) {
+                    const double cycles = result.counts[(int)PerfCounter::Cycles];
+
+                    std::cout << std::fixed << std::setprecision(0) << std::setw(12) << cycles
+                        << std::setprecision(2) << std::setw(7) << (cycles > 0.0 ? result.counts[(int)PerfCounter::Instructions] / cycles : 0.0)
+                        << std::setprecision(1) << std::setw(10) << result.counts[(int)PerfCounter::L1DataMisses]
+                        << std::setw(10) << result.counts[(int)PerfCounter::LastLevelMisses]
+                        << std::setw(10) << result.counts[(int)PerfCounter::BranchMisses] << std::defaultfloat;
+                }
+
+                auto it = baseline.find({ result.name, n });
+
+                if (it != baseline.end()) {
+                    const double change = result.nsPerCall / it->second - 1.0;
+                    const bool regression = change > options.threshold;
+
+                    std::cout << std::setw(11) << std::fixed << std::setprecision(1) << std::showpos << 100.0 * change << "%" << std::noshowpos << std::defaultfloat;
+                    if (regression) std::cout << "  REGRESSION";
+
+                    regressions += regression;
+                }
+
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    if (!options.output.empty()) {
+        WriteJson(options.output, results, options);
+    }
+
+    if (!baseline.empty()) {
+        std::cout << "\n" << regressions << " regressions slower than the baseline by more than " << 100.0 * options.threshold << "%" << std::endl;
+    }
+
+    return regressions > 0 ? 1 : 0;
+}
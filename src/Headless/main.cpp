@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "Physics/CpuFeatures.h"
+#include "Physics/Energy.h"
+#include "Physics/Ensemble.h"
+#include "Physics/Hermite.h"
+#include "Physics/Integrator.h"
+#include "Physics/ProfileCapture.h"
+#include "Physics/Scene.h"
+#include "Physics/SmallAtom.h"
+#include "Physics/ThreadPool.h"
+
+// Runs the simulator without a window: one atom, or with --replicas an ensemble of perturbed
+// copies of it, printing the throughput and optionally writing the results to a CSV file.
+
+struct Options {
+    int protons{ 2 };
+    int neutrons{ 2 };
+    int electrons{ 1 };
+
+    int steps{ 100000 };
+    float dt{ 0.001f };
+
+    bool hermite{ false };
+    bool general{ false };
+
+    int threads{ (int)std::thread::hardware_concurrency() };
+    SimdLevel simdLevel{ DetectSimdLevel() };
+
+    int replicas{ 0 };
+    std::uint64_t seed{ 1 };
+    float jitter{ 0.05f };
+    float escapeDistance{ 20.0f };
+
+    std::string output;
+
+    std::string trace;
+    float traceSeconds{ 5.0f };
+
+    bool counters{ false };
+};
+
+void PrintUsage() {
+    std::cout << "Usage: ClassicalAtomHeadless [options]\n"
+        "  --protons N        protons in the atom (2)\n"
+        "  --neutrons N       neutrons in the atom (2)\n"
+        "  --electrons N      electrons in the atom (1)\n"
+        "  --steps N          steps to run (100000)\n"
+        "  --dt T             time step (0.001)\n"
+        "  --integrator NAME  verlet or hermite (verlet)\n"
+        "  --general          always use the general force sums, never the small atom path\n"
+        "  --threads N        threads to run on (all)\n"
+        "  --simd NAME        scalar, sse4, avx2 or avx512 (best supported)\n"
+        "  --replicas N       run an ensemble of N perturbed copies instead of one atom\n"
+        "  --seed N           ensemble seed (1)\n"
+        "  --jitter X         largest ensemble perturbation of each position and velocity component (0.05)\n"
+        "  --escape R         distance from the nucleus at which a particle has escaped (20)\n"
+        "  --output PATH      write the final particles, or the ensemble replicas, as CSV\n"
+        "  --trace PATH       write the first seconds of a single atom run as a Chrome trace\n"
+        "  --trace-seconds T  seconds to trace (5)\n"
+        "  --counters         report hardware counters per step of each stage of a single atom run (Linux)\n";
+}
+
+bool ParseSimdLevel(std::string_view name, SimdLevel& level) {
+    if (name == "scalar") level = SimdLevel::Scalar;
+    else if (name == "sse4") level = SimdLevel::Sse4;
+    else if (name == "avx2") level = SimdLevel::Avx2;
+    else if (name == "avx512") level = SimdLevel::Avx512;
+    else return false;
+
+    return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view option = argv[i];
+
+        if (option == "--help") return false;
+
+        if (option == "--general") {
+            options.general = true;
+            continue;
+        }
+
+        if (option == "--counters") {
+            options.counters = true;
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            std::cout << "ERROR: Missing value for " << option << std::endl;
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        if (option == "--protons") options.protons = std::atoi(value);
+        else if (option == "--neutrons") options.neutrons = std::atoi(value);
+        else if (option == "--electrons") options.electrons = std::atoi(value);
+        else if (option == "--steps") options.steps = std::atoi(value);
+        else if (option == "--dt") options.dt = (float)std::atof(value);
+        else if (option == "--threads") options.threads = std::atoi(value);
+        else if (option == "--replicas") options.replicas = std::atoi(value);
+        else if (option == "--seed") options.seed = std::strtoull(value, nullptr, 10);
+        else if (option == "--jitter") options.jitter = (float)std::atof(value);
+        else if (option == "--escape") options.escapeDistance = (float)std::atof(value);
+        else if (option == "--output") options.output = value;
+        else if (option == "--trace") options.trace = value;
+        else if (option == "--trace-seconds") options.traceSeconds = (float)std::atof(value);
+        else if (option == "--integrator") {
+            std::string_view name = value;
+
+            if (name == "verlet") options.hermite = false;
+            else if (name == "hermite") options.hermite = true;
+            else {
+                std::cout << "ERROR: Unknown integrator " << name << std::endl;
+                return false;
+            }
+        }
+        else if (option == "--simd") {
+            if (!ParseSimdLevel(value, options.simdLevel)) {
+                std::cout << "ERROR: Unknown instruction set " << value << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cout << "ERROR: Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+
+    if (options.protons < 0 || options.neutrons < 0 || options.electrons < 0 || options.steps < 1 || options.dt <= 0.0f) {
+        std::cout << "ERROR: Particle counts must not be negative, and the step count and time step must be positive." << std::endl;
+        return false;
+    }
+
+    if (options.simdLevel > DetectSimdLevel()) {
+        std::cout << "ERROR: " << SimdLevelName(options.simdLevel) << " is not supported by this processor." << std::endl;
+        return false;
+    }
+
+    if ((!options.trace.empty() || options.counters) && options.replicas > 0) {
+        std::cout << "ERROR: Only single atom runs can be traced or counted." << std::endl;
+        return false;
+    }
+
+    options.threads = std::max(options.threads, 1);
+
+    return true;
+}
+
+// Pairs evaluated per force evaluation by the direct sums
+double PairCount(const Particles& particles) {
+    double charged = particles.ChargedEnd();
+    double nucleons = particles.Size() - particles.NucleonBegin();
+
+    return 0.5 * charged * (charged - 1.0) + 0.5 * nucleons * (nucleons - 1.0);
+}
+
+int RunAtom(const Options& options) {
+    PhysicsState state{ };
+    AddToState(state, options.neutrons, options.protons, options.electrons);
+
+    Particles& particles = state.particles;
+
+    ThreadPool pool{ options.threads };
+    ForceAccumulator accumulator{ };
+    Vec3Array coulombForces{ };
+    Vec3Array nuclearForces{ };
+    Vec3Array forces{ };
+
+    // Profiled as the Coulomb and Nuclear stages
+    auto computeForces = [&]() {
+        DirectForces(particles, accumulator, pool, options.simdLevel, coulombForces, nuclearForces, forces);
+    };
+
+    const double initialEnergy = TotalEnergy(particles);
+
+    SmallAtom smallAtom{ };
+    HermiteIntegrator hermite{ };
+
+    const bool small = !options.hermite && !options.general && smallAtom.Load(particles);
+    const char* path = options.hermite ? "Hermite" : (small ? "velocity Verlet, small atom" : "velocity Verlet");
+
+    ProfileCapture capture{ };
+
+    // Hardware counts of each stage summed over the whole run
+    std::vector<ProfileTotal> totals{ };
+    std::vector<ProfileEvent> events{ };
+    std::uint64_t readPosition = 0;
+
+    if (options.counters) {
+        if (!Profiler::ThisThread().OpenCounters()) {
+            std::cout << "ERROR: Could not open the hardware counters, perf_event_open is unavailable or not permitted." << std::endl;
+        }
+
+        Profiler::enabled.store(true, std::memory_order_relaxed);
+        Profiler::countersEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    if (!options.trace.empty()) {
+        Profiler::SetThreadName("Physics");
+
+        capture.duration = options.traceSeconds;
+        capture.Start();
+    }
+
+    auto drainProfile = [&]() {
+        capture.Update();
+
+        if (!options.counters) return;
+
+        readPosition = Profiler::ThisThread().Read(readPosition, events);
+
+        AccumulateProfileTotals(events, totals);
+        events.clear();
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    double forceEvaluations = options.steps;
+
+    // Steps between drains of the profiler's buffer, few enough that it never wraps
+    const int traceInterval = 1024;
+
+    if (small) {
+        // Batches rather than one call, so a trace shows the steps going by
+        for (int step = 0; step < options.steps; step += traceInterval) {
+            ProfileScope profileScope{ "Step Batch" };
+
+            smallAtom.Step(options.dt, std::min(traceInterval, options.steps - step));
+            drainProfile();
+        }
+
+        smallAtom.Store(particles);
+    }
+    else if (options.hermite) {
+        forceEvaluations = 0.0;
+
+        for (int step = 0; step < options.steps; ++step) {
+            {
+                ProfileScope profileScope{ "Step" };
+
+                hermite.Step(particles, options.dt, pool);
+                forceEvaluations += hermite.GetSubstepCount();
+            }
+
+            if (step % traceInterval == 0) drainProfile();
+        }
+    }
+    else {
+        computeForces();
+
+        for (int step = 0; step < options.steps; ++step) {
+            {
+                ProfileScope profileScope{ "Step" };
+
+                {
+                    ProfileScope integrateScope{ "Integrate" };
+
+                    Kick(particles, 0, particles.Size(), forces, 0.5f * options.dt, pool);
+                    Drift(particles, 0, particles.Size(), options.dt, false, 0.0f, pool);
+                }
+
+                computeForces();
+
+                ProfileScope integrateScope{ "Integrate" };
+                Kick(particles, 0, particles.Size(), forces, 0.5f * options.dt, pool);
+            }
+
+            if (step % traceInterval == 0) drainProfile();
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    drainProfile();
+
+    const double finalEnergy = TotalEnergy(particles);
+
+    std::cout << "Particles:             " << particles.Size() << " (" << options.protons << " protons, " << options.neutrons << " neutrons, " << options.electrons << " electrons)\n";
+    std::cout << "Integrator:            " << path << ", " << SimdLevelName(options.simdLevel) << ", " << options.threads << " threads\n";
+    std::cout << "Steps:                 " << options.steps << " in " << seconds << " s\n";
+    std::cout << "Steps per second:      " << options.steps / seconds << "\n";
+    std::cout << "Pairs per second:      " << PairCount(particles) * forceEvaluations / seconds << "\n";
+    std::cout << "Relative energy drift: " << std::abs(finalEnergy - initialEnergy) / std::max(std::abs(initialEnergy), 1e-30) << std::endl;
+
+    if (!options.trace.empty()) {
+        capture.Stop();
+
+        if (!capture.WriteChromeTrace(options.trace)) return 1;
+
+        std::cout << "Trace:                 " << capture.GetEventCount() << " scopes over " << capture.GetCapturedTime() << " s, " << capture.GetDroppedCount() << " dropped\n";
+    }
+
+    if (options.counters) {
+        std::cout << "\nPer step      " << std::right;
+
+        for (int i = 0; i < PerfCounterCount; ++i) {
+            std::cout << std::setw(15) << PerfCounterName((PerfCounter)i);
+        }
+
+        std::cout << std::setw(8) << "IPC" << "\n";
+
+        for (const ProfileTotal& total : totals) {
+            if (total.countedCount == 0) continue;
+
+            std::cout << std::left << std::setw(14) << std::string(2 * total.depth, ' ') + total.name << std::right << std::fixed << std::setprecision(1);
+
+            for (int i = 0; i < PerfCounterCount; ++i) {
+                std::cout << std::setw(15) << (double)total.counts[i] / options.steps;
+            }
+
+            const double cycles = (double)total.counts[(int)PerfCounter::Cycles];
+            std::cout << std::setw(8) << std::setprecision(2) << (cycles > 0.0 ? total.counts[(int)PerfCounter::Instructions] / cycles : 0.0) << std::defaultfloat << "\n";
+        }
+    }
+
+    if (!options.output.empty()) {
+        std::ofstream file{ options.output };
+
+        if (!file) {
+            std::cout << "ERROR: Could not open " << options.output << std::endl;
+            return 1;
+        }
+
+        file << std::setprecision(9);
+
+        const char* speciesNames[] = { "electron", "proton", "neutron" };
+
+        file << "species,x,y,z,vx,vy,vz\n";
+
+        for (int i = 0; i < particles.Size(); ++i) {
+            file << speciesNames[(int)particles.species[i]] << ',' << particles.x[i] << ',' << particles.y[i] << ',' << particles.z[i] << ','
+                << particles.vx[i] << ',' << particles.vy[i] << ',' << particles.vz[i] << '\n';
+        }
+    }
+
+    return 0;
+}
+
+int RunEnsemble(const Options& options) {
+    Ensemble ensemble{ };
+    ensemble.protonCount = options.protons;
+    ensemble.neutronCount = options.neutrons;
+    ensemble.electronCount = options.electrons;
+    ensemble.replicaCount = options.replicas;
+    ensemble.seed = options.seed;
+    ensemble.positionJitter = options.jitter;
+    ensemble.velocityJitter = options.jitter;
+    ensemble.timeStep = options.dt;
+    ensemble.stepCount = options.steps;
+    ensemble.escapeDistance = options.escapeDistance;
+    ensemble.simdLevel = options.simdLevel;
+    ensemble.batchReplicas = !options.general;
+
+    ThreadPool pool{ options.threads };
+    ensemble.Reset();
+    ensemble.Run(pool);
+
+    const EnsembleStatistics statistics = ensemble.GetStatistics();
+
+    std::cout << "Replicas:               " << statistics.replicaCount << " of " << options.protons << " protons, " << options.neutrons << " neutrons, " << options.electrons << " electrons\n";
+    std::cout << "Instruction set:        " << SimdLevelName(options.simdLevel) << ", " << options.threads << " threads\n";
+    std::cout << "Replica steps / second: " << statistics.stepsPerSecond << "\n";
+    std::cout << "Ionized:                " << 100.0f * statistics.ionizedFraction << "%, mean escape time " << statistics.meanElectronEscapeTime << ", median " << statistics.medianElectronEscapeTime << "\n";
+    std::cout << "Nucleus broken:         " << 100.0f * statistics.brokenFraction << "%, mean escape time " << statistics.meanNucleonEscapeTime << "\n";
+    std::cout << "Relative energy drift:  mean " << statistics.meanEnergyDrift << ", max " << statistics.maxEnergyDrift << std::endl;
+
+    if (!options.output.empty()) {
+        std::ofstream file{ options.output };
+
+        if (!file) {
+            std::cout << "ERROR: Could not open " << options.output << std::endl;
+            return 1;
+        }
+
+        file << std::setprecision(9);
+
+        file << "replica,seed,steps,electron_escape_time,nucleon_escape_time,escaped_electrons,escaped_nucleons,initial_energy,final_energy\n";
+
+        const std::vector<ReplicaResult>& results = ensemble.GetResults();
+
+        for (int i = 0; i < (int)results.size(); ++i) {
+            const ReplicaResult& result = results[i];
+
+            file << i << ',' << result.seed << ',' << result.stepCount << ',' << result.electronEscapeTime << ',' << result.nucleonEscapeTime << ','
+                << result.escapedElectrons << ',' << result.escapedNucleons << ',' << result.initialEnergy << ',' << result.finalEnergy << '\n';
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options{ };
+
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    return options.replicas > 0 ? RunEnsemble(options) : RunAtom(options);
+}
@@ -0,0 +1,72 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<std::uint64_t> allocationCount{ 0 };
+    thread_local bool countThisThread{ false };
+
+    void Count() {
+        if (countThisThread) allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* AllocateAligned(std::size_t size, std::size_t alignment) {
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        // aligned_alloc wants a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void FreeAligned(void* pointer) {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+void CountAllocationsOnThisThread() {
+    countThisThread = true;
+}
+
+std::uint64_t GetAllocationCount() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+// The array and nothrow forms forward to these by default. The sized deletes are replaced as well,
+// some standard libraries route them to their own free otherwise
+
+void* operator new(std::size_t size) {
+    Count();
+
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+    throw std::bad_alloc{ };
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    Count();
+
+    if (void* pointer = AllocateAligned(size == 0 ? 1 : size, (std::size_t)alignment)) return pointer;
+    throw std::bad_alloc{ };
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
+}
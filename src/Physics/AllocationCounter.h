@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts heap allocations made through operator new by threads that opted in, so the physics
+// step can be checked to run without allocating. The global operator new and delete are replaced
+// in AllocationCounter.cpp, threads that did not opt in only pay for a thread local check.
+
+// Counts the calling thread's allocations from now on
+void CountAllocationsOnThisThread();
+
+// Allocations made so far by every counted thread
+std::uint64_t GetAllocationCount();
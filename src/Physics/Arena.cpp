@@ -0,0 +1,51 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(std::size_t capacity)
+    : m_Buffer(std::make_unique<std::byte[]>(capacity)), m_Capacity(capacity) { }
+
+void* Arena::Allocate(std::size_t bytes, std::size_t alignment) {
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_Buffer.get());
+    const std::uintptr_t aligned = (base + m_Offset + alignment - 1) / alignment * alignment;
+    const std::size_t end = (std::size_t)(aligned - base) + bytes;
+
+    if (end <= m_Capacity) {
+        m_Offset = end;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Over allocate by the alignment so the block can be aligned by hand
+    m_Overflow.push_back(std::make_unique<std::byte[]>(bytes + alignment));
+    m_OverflowBytes += bytes + alignment;
+
+    const std::uintptr_t block = reinterpret_cast<std::uintptr_t>(m_Overflow.back().get());
+    return reinterpret_cast<void*>((block + alignment - 1) / alignment * alignment);
+}
+
+std::size_t Arena::Mark() {
+    ++m_Depth;
+    return m_Offset;
+}
+
+void Arena::Rewind(std::size_t mark) {
+    m_Offset = mark;
+
+    if (--m_Depth > 0 || m_Overflow.empty()) return;
+
+    // Nothing is in use any more, grow the buffer so the same workload fits next time
+    std::size_t capacity = m_Capacity;
+    while (capacity < m_Capacity + m_OverflowBytes) capacity *= 2;
+
+    m_Overflow.clear();
+    m_OverflowBytes = 0;
+
+    m_Buffer = std::make_unique<std::byte[]>(capacity);
+    m_Capacity = capacity;
+}
+
+Arena& ThreadScratch() {
+    thread_local Arena arena{ };
+    return arena;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for scratch memory that only lives for part of a physics step.
+//
+// Allocations come from one buffer by advancing an offset, and Rewind drops everything allocated
+// since the matching Mark in one go. When the buffer runs out the request is served from a
+// separate overflow block instead, and once the outermost mark is rewound the buffer is regrown to
+// fit everything, so after the first few steps scratch memory never touches the heap again. Only
+// for trivially destructible types, nothing is ever destroyed.
+class Arena {
+public:
+    explicit Arena(std::size_t capacity = 64 * 1024);
+
+    void* Allocate(std::size_t bytes, std::size_t alignment);
+
+    template<typename T>
+    T* Allocate(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena memory is never destroyed");
+
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Marks nest, each must be rewound in reverse order
+    std::size_t Mark();
+    void Rewind(std::size_t mark);
+
+    std::size_t GetCapacity() const { return m_Capacity; }
+
+private:
+    std::unique_ptr<std::byte[]> m_Buffer;
+    std::size_t m_Capacity{ 0 };
+    std::size_t m_Offset{ 0 };
+
+    std::vector<std::unique_ptr<std::byte[]>> m_Overflow;
+    std::size_t m_OverflowBytes{ 0 };
+
+    int m_Depth{ 0 };
+};
+
+// Arena of the calling thread, physics tasks take their scratch memory from it
+Arena& ThreadScratch();
+
+// Marks an arena on construction and rewinds it on destruction
+class ScratchScope {
+public:
+    explicit ScratchScope(Arena& arena = ThreadScratch()) : m_Arena(arena), m_Mark(arena.Mark()) { }
+    ~ScratchScope() { m_Arena.Rewind(m_Mark); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    template<typename T>
+    T* Allocate(std::size_t count) { return m_Arena.Allocate<T>(count); }
+
+private:
+    Arena& m_Arena;
+    std::size_t m_Mark;
+};
@@ -0,0 +1,236 @@
+#include "BarnesHut.h"
+
+#include <algorithm>
+#include <array>
+
+#include "Parallel.h"
+
+void BarnesHutTree::Build(const Particles& particles, int begin, int end) {
+    m_Particles = &particles;
+
+    const int count = end - begin;
+
+    m_Nodes.clear();
+    m_Indices.resize(count);
+    m_Scratch.resize(count);
+
+    if (count <= 0) return;
+
+    glm::vec3 minimum{ particles.Position(begin) };
+    glm::vec3 maximum{ minimum };
+
+    for (int i = 0; i < count; ++i) {
+        m_Indices[i] = begin + i;
+
+        minimum = glm::min(minimum, particles.Position(begin + i));
+        maximum = glm::max(maximum, particles.Position(begin + i));
+    }
+
+    glm::vec3 extent = maximum - minimum;
+    float halfSize = glm::max(extent.x, glm::max(extent.y, extent.z)) * 0.5f;
+
+    // Keep a degenerate (single point) root splittable and make sure every particle is strictly inside
+    halfSize = halfSize * 1.0001f + 1e-6f;
+
+    Node root{ };
+    root.center = (minimum + maximum) * 0.5f;
+    root.halfSize = halfSize;
+    root.firstChild = -1;
+    root.begin = 0;
+    root.count = count;
+
+    m_Nodes.push_back(root);
+
+    Split(0, 0);
+    ComputeMoments(0);
+}
+
+void BarnesHutTree::Split(int nodeIndex, int depth) {
+    if (m_Nodes[nodeIndex].count <= leafCapacity || depth >= maxDepth) return;
+
+    const Particles& particles = *m_Particles;
+
+    Node node = m_Nodes[nodeIndex];
+
+    auto octantOf = [&](int index) {
+        const glm::vec3 p = particles.Position(index);
+        return (p.x >= node.center.x ? 1 : 0) | (p.y >= node.center.y ? 2 : 0) | (p.z >= node.center.z ? 4 : 0);
+    };
+
+    // Counting sort of the node's range by octant
+    std::array<int, 8> counts{ };
+    for (int i = node.begin; i < node.begin + node.count; ++i) {
+        ++counts[octantOf(m_Indices[i])];
+    }
+
+    std::array<int, 8> offsets{ };
+    offsets[0] = node.begin;
+    for (int o = 1; o < 8; ++o) {
+        offsets[o] = offsets[o - 1] + counts[o - 1];
+    }
+
+    std::array<int, 8> cursor = offsets;
+    for (int i = node.begin; i < node.begin + node.count; ++i) {
+        m_Scratch[cursor[octantOf(m_Indices[i])]++] = m_Indices[i];
+    }
+
+    std::copy(m_Scratch.begin() + node.begin, m_Scratch.begin() + node.begin + node.count, m_Indices.begin() + node.begin);
+
+    int firstChild = (int)m_Nodes.size();
+    m_Nodes[nodeIndex].firstChild = firstChild;
+
+    float childHalfSize = node.halfSize * 0.5f;
+    for (int o = 0; o < 8; ++o) {
+        Node child{ };
+        child.center = node.center + glm::vec3{
+            (o & 1) ? childHalfSize : -childHalfSize,
+            (o & 2) ? childHalfSize : -childHalfSize,
+            (o & 4) ? childHalfSize : -childHalfSize
+        };
+        child.halfSize = childHalfSize;
+        child.firstChild = -1;
+        child.begin = offsets[o];
+        child.count = counts[o];
+
+        m_Nodes.push_back(child);
+    }
+
+    for (int o = 0; o < 8; ++o) {
+        Split(firstChild + o, depth + 1);
+    }
+}
+
+void BarnesHutTree::ComputeMoments(int nodeIndex) {
+    const Particles& particles = *m_Particles;
+
+    Node& node = m_Nodes[nodeIndex];
+
+    float charge = 0.0f;
+    float absCharge = 0.0f;
+    glm::vec3 weighted{ 0.0f };
+
+    if (node.firstChild == -1) {
+        for (int i = node.begin; i < node.begin + node.count; ++i) {
+            int index = m_Indices[i];
+
+            charge += particles.charge[index];
+            absCharge += glm::abs(particles.charge[index]);
+            weighted += glm::abs(particles.charge[index]) * particles.Position(index);
+        }
+
+        glm::vec3 chargeCenter = absCharge > 0.0f ? weighted / absCharge : node.center;
+
+        glm::vec3 dipole{ 0.0f };
+        for (int i = node.begin; i < node.begin + node.count; ++i) {
+            int index = m_Indices[i];
+
+            dipole += particles.charge[index] * (particles.Position(index) - chargeCenter);
+        }
+
+        node.charge = charge;
+        node.absCharge = absCharge;
+        node.chargeCenter = chargeCenter;
+        node.dipole = dipole;
+
+        return;
+    }
+
+    int firstChild = node.firstChild;
+
+    for (int o = 0; o < 8; ++o) {
+        ComputeMoments(firstChild + o);
+    }
+
+    for (int o = 0; o < 8; ++o) {
+        const Node& child = m_Nodes[firstChild + o];
+
+        charge += child.charge;
+        absCharge += child.absCharge;
+        weighted += child.absCharge * child.chargeCenter;
+    }
+
+    glm::vec3 chargeCenter = absCharge > 0.0f ? weighted / absCharge : node.center;
+
+    // Shift each child's dipole to the parent's expansion centre
+    glm::vec3 dipole{ 0.0f };
+    for (int o = 0; o < 8; ++o) {
+        const Node& child = m_Nodes[firstChild + o];
+
+        dipole += child.dipole + child.charge * (child.chargeCenter - chargeCenter);
+    }
+
+    node.charge = charge;
+    node.absCharge = absCharge;
+    node.chargeCenter = chargeCenter;
+    node.dipole = dipole;
+}
+
+glm::vec3 BarnesHutTree::Field(int self, float theta) const {
+    glm::vec3 field{ 0.0f };
+
+    if (m_Nodes.empty()) return field;
+
+    const Particles& particles = *m_Particles;
+    const glm::vec3 position = particles.Position(self);
+
+    std::array<int, 8 * 64> stack;
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_Nodes[stack[--stackSize]];
+
+        if (node.count == 0 || node.absCharge == 0.0f) continue;
+
+        glm::vec3 offset = position - node.chargeCenter;
+        float distanceSquared = glm::dot(offset, offset);
+
+        glm::vec3 fromCenter = glm::abs(position - node.center);
+        bool inside = fromCenter.x <= node.halfSize && fromCenter.y <= node.halfSize && fromCenter.z <= node.halfSize;
+
+        float size = 2.0f * node.halfSize;
+
+        if (!inside && size * size < theta * theta * distanceSquared) {
+            float inverseDistance = 1.0f / glm::sqrt(distanceSquared);
+            float inverseDistance2 = inverseDistance * inverseDistance;
+            float inverseDistance3 = inverseDistance2 * inverseDistance;
+
+            field += node.charge * inverseDistance3 * offset;
+            field += (3.0f * glm::dot(node.dipole, offset) * inverseDistance2 * offset - node.dipole) * inverseDistance3;
+
+            continue;
+        }
+
+        if (node.firstChild == -1) {
+            for (int i = node.begin; i < node.begin + node.count; ++i) {
+                int j = m_Indices[i];
+                if (j == self) continue;
+
+                glm::vec3 r = position - particles.Position(j);
+                float distance = glm::sqrt(glm::dot(r, r));
+
+                field += (particles.charge[j] / (distance * distance * distance)) * r;
+            }
+
+            continue;
+        }
+
+        for (int o = 0; o < 8; ++o) {
+            stack[stackSize++] = node.firstChild + o;
+        }
+    }
+
+    return field;
+}
+
+void BarnesHutCoulombField(BarnesHutTree& tree, const Particles& particles, int begin, int end, float theta, ThreadPool& pool, Vec3Array& field) {
+    tree.Build(particles, begin, end);
+
+    field.Assign(particles.Size());
+
+    ParallelFor(pool, end - begin, [&](int rangeBegin, int rangeEnd, int) {
+        for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+            field.Set(i, tree.Field(i, theta));
+        }
+    });
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Barnes-Hut octree for the Coulomb force.
+//
+// Each node stores the monopole and dipole moment of the charges below it, taken about the
+// node's centre of |charge|. A node is accepted as a single source once size / distance < theta.
+// The dipole term matters here: atoms are close to neutral, so a monopole-only tree would
+// throw away almost all of the far field.
+//
+// RMS relative error of the per-particle acceleration against the direct sum (CoulombFieldError):
+// for random clouds of 1k to 16k charges about 5e-3 at theta = 0.5 and 1e-3 at theta = 0.3. On
+// the alternating proton and electron lattices AddToState builds almost all of the field cancels,
+// so the relative error is much larger and depends on the size: 4e-2 at theta = 0.5 and 1e-2 at
+// theta = 0.3 for 16k charges, but 0.2 to 0.6 and 4e-2 to 0.15 for 1k, 4k and 64k charges.
+// theta = 0 opens every node and reproduces the direct sum up to float rounding.
+class BarnesHutTree {
+public:
+    struct Node {
+        glm::vec3 center;
+        float halfSize;
+
+        glm::vec3 chargeCenter;
+        float charge;
+        float absCharge;
+        glm::vec3 dipole;
+
+        int firstChild; // Index of 8 contiguous children, -1 for leaves
+        int begin;      // Range into the sorted list of particle indices
+        int count;
+    };
+
+    int leafCapacity{ 8 };
+    int maxDepth{ 32 };
+
+    // Builds the tree over the particles in [begin, end)
+    void Build(const Particles& particles, int begin, int end);
+
+    // Coulomb field (force per unit charge) at the position of particle 'self'
+    glm::vec3 Field(int self, float theta) const;
+
+    const std::vector<Node>& GetNodes() const { return m_Nodes; }
+
+private:
+    void Split(int nodeIndex, int depth);
+    void ComputeMoments(int nodeIndex);
+
+    const Particles* m_Particles{ nullptr };
+
+    std::vector<Node> m_Nodes;
+    std::vector<int> m_Indices;
+    std::vector<int> m_Scratch;
+};
+
+// Builds the tree and writes the Coulomb field at every particle in [begin, end), field is indexed like particles
+void BarnesHutCoulombField(BarnesHutTree& tree, const Particles& particles, int begin, int end, float theta, ThreadPool& pool, Vec3Array& field);
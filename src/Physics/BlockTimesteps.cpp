@@ -0,0 +1,37 @@
+#include "BlockTimesteps.h"
+
+#include <cmath>
+
+int BlockTimesteps::LevelFor(const Particles& particles, const Vec3Array& forces, int i, float timeStep, int clampedMaxLevel) const {
+    const glm::vec3 acceleration = forces.Get(i) * particles.inverseMass[i];
+    const float magnitude = glm::length(acceleration);
+
+    if (!(magnitude > 0.0f)) return 0;
+
+    const float step = accuracy / std::sqrt(magnitude);
+    if (!(step < timeStep)) return 0;
+
+    return std::min((int)std::ceil(std::log2(timeStep / step)), clampedMaxLevel);
+}
+
+void BlockTimesteps::CountLevels(int clampedMaxLevel) {
+    m_LevelCounts.assign(clampedMaxLevel + 1, 0);
+
+    for (int level : m_Levels) {
+        ++m_LevelCounts[level];
+    }
+}
+
+void BlockTimesteps::HalfKick(Particles& particles, const Vec3Array& forces, const int* indices, int count, float timeStep, ThreadPool& pool) {
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+        for (int a = rangeBegin; a < rangeEnd; ++a) {
+            const int i = indices[a];
+
+            const float scale = particles.inverseMass[i] * 0.5f * timeStep / (float)(1 << m_Levels[i]);
+
+            particles.vx[i] += forces.x[i] * scale;
+            particles.vy[i] += forces.y[i] * scale;
+            particles.vz[i] += forces.z[i] * scale;
+        }
+    });
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "Integrator.h"
+#include "Parallel.h"
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Hierarchical block time steps: every particle advances with its own step timeStep / 2^level,
+// chosen from its acceleration as accuracy / sqrt(|a|) (lengths in units of the lattice spacing)
+// and rounded down to a power of two. Steps of neighbouring levels line up, so at any moment the
+// particles whose step ends are an exact block and only their forces are recomputed.
+//
+// Each particle is integrated with kick-drift-kick leapfrog on its own step: all positions drift
+// together from one step boundary to the next, and a particle is kicked when its step opens and
+// when it closes. At a step boundary a particle may move to a finer level freely, and to a
+// coarser one only where that coarser step would also start, keeping the hierarchy aligned.
+class BlockTimesteps {
+public:
+    int maxLevel{ 8 };        // The finest step is timeStep / 2^maxLevel
+    float accuracy{ 0.01f };
+
+    // Advances the particles by timeStep. forces must hold the force on every particle at the
+    // current positions, and is left holding those at the new ones. computeForces(targets, count)
+    // must update forces for the count particles in targets (sorted, in particle order) at the
+    // current positions, the other entries may be overwritten as well.
+    template<typename ForceFunction>
+    void Step(Particles& particles, float timeStep, bool periodic, float boxSize, Vec3Array& forces, ThreadPool& pool, ForceFunction&& computeForces);
+
+    // Levels are recomputed from scratch on the next Step, for when the particles are replaced
+    void Invalidate() {
+        m_Levels.clear();
+        m_LevelCounts.clear();
+        m_EvaluationsPerParticle = 0.0f;
+    }
+
+    // Number of particles on each level after the last Step. Only valid on the thread that steps,
+    // copy it out alongside the particles for anyone else
+    const std::vector<int>& GetLevelCounts() const { return m_LevelCounts; }
+
+    // Force evaluations per particle in the last Step, a single global step would need 2^finest level
+    float GetEvaluationsPerParticle() const { return m_EvaluationsPerParticle; }
+
+private:
+    int LevelFor(const Particles& particles, const Vec3Array& forces, int i, float timeStep, int clampedMaxLevel) const;
+    void CountLevels(int clampedMaxLevel);
+
+    // Kicks the listed particles by half of their own step
+    void HalfKick(Particles& particles, const Vec3Array& forces, const int* indices, int count, float timeStep, ThreadPool& pool);
+
+    std::vector<int> m_Levels;
+    std::vector<int> m_LevelCounts;
+    std::vector<int> m_Active;
+
+    float m_EvaluationsPerParticle{ 0.0f };
+};
+
+template<typename ForceFunction>
+void BlockTimesteps::Step(Particles& particles, float timeStep, bool periodic, float boxSize, Vec3Array& forces, ThreadPool& pool, ForceFunction&& computeForces) {
+    const int count = particles.Size();
+    const int levels = std::clamp(maxLevel, 0, 20);
+    const int ticks = 1 << levels;
+    const float tick = timeStep / ticks;
+
+    if ((int)m_Levels.size() != count) {
+        m_Levels.resize(count);
+
+        for (int i = 0; i < count; ++i) {
+            m_Levels[i] = LevelFor(particles, forces, i, timeStep, levels);
+        }
+    }
+
+    for (int& level : m_Levels) {
+        level = std::min(level, levels);
+    }
+
+    CountLevels(levels);
+
+    // Every step opens together at the start of the block
+    m_Active.resize(count);
+    for (int i = 0; i < count; ++i) {
+        m_Active[i] = i;
+    }
+
+    HalfKick(particles, forces, m_Active.data(), count, timeStep, pool);
+
+    long long evaluations = 0;
+    int t = 0;
+
+    while (t < ticks) {
+        int finest = 0;
+        for (int level = levels; level > 0; --level) {
+            if (m_LevelCounts[level] > 0) {
+                finest = level;
+                break;
+            }
+        }
+
+        const int stride = ticks >> finest;
+        const int next = (t / stride + 1) * stride;
+
+        Drift(particles, 0, count, (next - t) * tick, periodic, boxSize, pool);
+        t = next;
+
+        m_Active.clear();
+        for (int i = 0; i < count; ++i) {
+            if (t % (ticks >> m_Levels[i]) == 0) m_Active.push_back(i);
+        }
+
+        computeForces((const int*)m_Active.data(), (int)m_Active.size());
+        evaluations += (long long)m_Active.size();
+
+        // Close the steps that just ended, pick the next level and open the next step
+        HalfKick(particles, forces, m_Active.data(), (int)m_Active.size(), timeStep, pool);
+
+        ParallelFor(pool, (int)m_Active.size(), [&](int rangeBegin, int rangeEnd, int) {
+            for (int a = rangeBegin; a < rangeEnd; ++a) {
+                const int i = m_Active[a];
+
+                int level = LevelFor(particles, forces, i, timeStep, levels);
+
+                while (level < m_Levels[i] && t % (ticks >> level) != 0) {
+                    ++level;
+                }
+
+                m_Levels[i] = level;
+            }
+        });
+
+        CountLevels(levels);
+
+        if (t < ticks) {
+            HalfKick(particles, forces, m_Active.data(), (int)m_Active.size(), timeStep, pool);
+        }
+    }
+
+    m_EvaluationsPerParticle = count > 0 ? (float)evaluations / count : 0.0f;
+}
@@ -0,0 +1,172 @@
+#include "CellList.h"
+
+#include <algorithm>
+
+#include "Arena.h"
+#include "Periodic.h"
+
+void CellList::Build(const Particles& particles, int begin, int end, float cellSize, bool periodic, float boxSize) {
+    const int count = std::max(0, end - begin);
+
+    m_Periodic = periodic;
+    cellSize = std::max(cellSize, 1e-3f);
+
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 extent{ 0.0f };
+
+    if (periodic) {
+        extent = glm::vec3{ boxSize };
+    }
+    else if (count > 0) {
+        glm::vec3 minimum{ particles.Position(begin) };
+        glm::vec3 maximum{ minimum };
+
+        for (int i = begin; i < end; ++i) {
+            minimum = glm::min(minimum, particles.Position(i));
+            maximum = glm::max(maximum, particles.Position(i));
+        }
+
+        origin = minimum;
+        extent = maximum - minimum;
+    }
+
+    glm::ivec3 dimensions{ 1 };
+    for (int axis = 0; axis < 3; ++axis) {
+        dimensions[axis] = std::max(1, (int)std::min(extent[axis] / cellSize, 1024.0f));
+    }
+
+    // A scene that has flown apart would otherwise get a huge mostly empty grid, wider cells are still correct
+    const long long maxCells = 2LL * count + 64;
+    while ((long long)dimensions.x * dimensions.y * dimensions.z > maxCells) {
+        for (int axis = 0; axis < 3; ++axis) {
+            dimensions[axis] = std::max(1, dimensions[axis] / 2);
+        }
+    }
+
+    if (periodic && (dimensions.x < 3 || dimensions.y < 3 || dimensions.z < 3)) {
+        dimensions = glm::ivec3{ 1 };
+    }
+
+    m_Dimensions = dimensions;
+
+    glm::vec3 inverseCellWidth{ 0.0f };
+    for (int axis = 0; axis < 3; ++axis) {
+        inverseCellWidth[axis] = dimensions[axis] / std::max(extent[axis], 1e-6f);
+    }
+
+    const int cellCount = dimensions.x * dimensions.y * dimensions.z;
+
+    // Counting sort by cell
+    m_CellStarts.assign(cellCount + 1, 0);
+    m_CellOfParticle.resize(count);
+
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position = particles.Position(begin + i);
+        if (periodic) position = WrapPosition(position, boxSize);
+
+        glm::ivec3 cell{ 0 };
+        for (int axis = 0; axis < 3; ++axis) {
+            cell[axis] = std::clamp((int)((position[axis] - origin[axis]) * inverseCellWidth[axis]), 0, dimensions[axis] - 1);
+        }
+
+        m_CellOfParticle[i] = CellIndex(cell);
+        ++m_CellStarts[m_CellOfParticle[i] + 1];
+    }
+
+    for (int cell = 0; cell < cellCount; ++cell) {
+        m_CellStarts[cell + 1] += m_CellStarts[cell];
+    }
+
+    m_Order.resize(count);
+    m_Positions.Assign(count);
+    m_Charges.resize(count);
+
+    ScratchScope scratch{ };
+
+    int* cursor = scratch.Allocate<int>(cellCount);
+    std::copy(m_CellStarts.begin(), m_CellStarts.end() - 1, cursor);
+
+    for (int i = 0; i < count; ++i) {
+        int sorted = cursor[m_CellOfParticle[i]]++;
+
+        m_Order[sorted] = begin + i;
+        m_Positions.x[sorted] = particles.x[begin + i];
+        m_Positions.y[sorted] = particles.y[begin + i];
+        m_Positions.z[sorted] = particles.z[begin + i];
+        m_Charges[sorted] = particles.charge[begin + i];
+    }
+}
+
+int CellList::ForwardNeighbours(int cell, std::array<int, 13>& neighbours) const {
+    const glm::ivec3 coordinates{
+        cell % m_Dimensions.x,
+        (cell / m_Dimensions.x) % m_Dimensions.y,
+        cell / (m_Dimensions.x * m_Dimensions.y)
+    };
+
+    // A periodic grid is either a single cell or at least three wide, so wrapped neighbours never repeat
+    if (m_Periodic && m_Dimensions.x == 1) return 0;
+
+    int count = 0;
+
+    for (int dz = 0; dz <= 1; ++dz) {
+        for (int dy = dz == 0 ? 0 : -1; dy <= 1; ++dy) {
+            for (int dx = (dz == 0 && dy == 0) ? 1 : -1; dx <= 1; ++dx) {
+                glm::ivec3 neighbour = coordinates + glm::ivec3{ dx, dy, dz };
+
+                bool outside = false;
+
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (m_Periodic) {
+                        neighbour[axis] = (neighbour[axis] + m_Dimensions[axis]) % m_Dimensions[axis];
+                    }
+                    else {
+                        outside |= neighbour[axis] < 0 || neighbour[axis] >= m_Dimensions[axis];
+                    }
+                }
+
+                if (!outside) neighbours[count++] = CellIndex(neighbour);
+            }
+        }
+    }
+
+    return count;
+}
+
+int CellList::Neighbours(int cell, std::array<int, 27>& neighbours) const {
+    const glm::ivec3 coordinates{
+        cell % m_Dimensions.x,
+        (cell / m_Dimensions.x) % m_Dimensions.y,
+        cell / (m_Dimensions.x * m_Dimensions.y)
+    };
+
+    if (m_Periodic && m_Dimensions.x == 1) {
+        neighbours[0] = cell;
+        return 1;
+    }
+
+    int count = 0;
+
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                glm::ivec3 neighbour = coordinates + glm::ivec3{ dx, dy, dz };
+
+                bool outside = false;
+
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (m_Periodic) {
+                        neighbour[axis] = (neighbour[axis] + m_Dimensions[axis]) % m_Dimensions[axis];
+                    }
+                    else {
+                        outside |= neighbour[axis] < 0 || neighbour[axis] >= m_Dimensions[axis];
+                    }
+                }
+
+                if (!outside) neighbours[count++] = CellIndex(neighbour);
+            }
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "Particles.h"
+
+// Uniform grid of cubic cells for short range pair sums. Build counting sorts the particles in
+// [begin, end) by cell, so it runs in linear time, and keeps a copy of their positions and
+// charges in that order: every cell, and therefore every neighbouring cell, is a contiguous
+// range that the row kernels can walk directly.
+//
+// Cells are at least cellSize wide, so every pair closer than cellSize is either in the same
+// cell or in two adjacent ones. In a periodic box the grid covers the box and wraps around, with
+// fewer than three cells per side the box is treated as a single cell.
+class CellList {
+public:
+    void Build(const Particles& particles, int begin, int end, float cellSize, bool periodic, float boxSize);
+
+    int GetCellCount() const { return (int)m_CellStarts.size() - 1; }
+    glm::ivec3 GetDimensions() const { return m_Dimensions; }
+
+    // Range of a cell in the sorted arrays
+    int CellBegin(int cell) const { return m_CellStarts[cell]; }
+    int CellEnd(int cell) const { return m_CellStarts[cell + 1]; }
+
+    // The up to 13 neighbours of a cell that come after it in a fixed half stencil, visiting a cell
+    // together with these covers every pair of adjacent cells exactly once
+    int ForwardNeighbours(int cell, std::array<int, 13>& neighbours) const;
+
+    // The cell itself and its up to 26 neighbours, for sums that visit every pair from both sides
+    int Neighbours(int cell, std::array<int, 27>& neighbours) const;
+
+    // Sorted position -> particle index
+    const std::vector<int>& GetOrder() const { return m_Order; }
+
+    // Positions and charges in sorted order
+    const Vec3Array& GetPositions() const { return m_Positions; }
+    const AlignedVector<float>& GetCharges() const { return m_Charges; }
+
+private:
+    int CellIndex(glm::ivec3 cell) const { return (cell.z * m_Dimensions.y + cell.y) * m_Dimensions.x + cell.x; }
+
+    glm::ivec3 m_Dimensions{ 0 };
+    bool m_Periodic{ false };
+
+    std::vector<int> m_CellStarts;
+    std::vector<int> m_CellOfParticle;
+    std::vector<int> m_Order;
+
+    Vec3Array m_Positions;
+    AlignedVector<float> m_Charges;
+};
@@ -0,0 +1,114 @@
+#include "Coulomb.h"
+
+#include <algorithm>
+
+#include "PairKernels.h"
+#include "Parallel.h"
+
+namespace {
+    glm::dvec3 DirectField(const Particles& particles, int begin, int end, int self) {
+        glm::dvec3 field{ 0.0 };
+
+        for (int j = begin; j < end; ++j) {
+            if (j == self) continue;
+
+            glm::dvec3 r{
+                (double)particles.x[self] - particles.x[j],
+                (double)particles.y[self] - particles.y[j],
+                (double)particles.z[self] - particles.z[j]
+            };
+
+            double distance = glm::sqrt(glm::dot(r, r));
+
+            field += (particles.charge[j] / (distance * distance * distance)) * r;
+        }
+
+        return field;
+    }
+}
+
+void DirectCoulombForces(const Particles& particles, int begin, int end, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    accumulator.Begin(forces, particles.Size(), ParallelTaskCount(pool, end - begin));
+
+    const PairRowKernel kernel = GetCoulombRowKernel(simdLevel);
+
+    ParallelForPairs(pool, end - begin, [&](int rangeBegin, int rangeEnd, int task) {
+        Vec3Array& buffer = accumulator.Buffer(task);
+
+        PairRow row{ };
+        row.x = particles.x.data();
+        row.y = particles.y.data();
+        row.z = particles.z.data();
+        row.charge = particles.charge.data();
+        row.fx = buffer.x.data();
+        row.fy = buffer.y.data();
+        row.fz = buffer.z.data();
+        row.jEnd = end;
+
+        for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+            row.i = i;
+            row.jBegin = i + 1;
+
+            glm::vec3 force = kernel(row);
+
+            buffer.x[i] += force.x;
+            buffer.y[i] += force.y;
+            buffer.z[i] += force.z;
+        }
+    });
+
+    accumulator.End(pool);
+}
+
+void DirectCoulombForcesOn(const Particles& particles, int begin, int end, const int* targets, int targetCount, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    if (forces.Size() != particles.Size()) forces.Assign(particles.Size());
+
+    const PairRowKernel kernel = GetCoulombRowKernel(simdLevel);
+
+    ParallelFor(pool, targetCount, [&](int rangeBegin, int rangeEnd, int) {
+        // No reaction buffers, only the targets' own forces are kept
+        PairRow row{ };
+        row.x = particles.x.data();
+        row.y = particles.y.data();
+        row.z = particles.z.data();
+        row.charge = particles.charge.data();
+
+        for (int t = rangeBegin; t < rangeEnd; ++t) {
+            const int i = targets[t];
+
+            row.i = i;
+            row.jBegin = begin;
+            row.jEnd = i;
+
+            glm::vec3 force = kernel(row);
+
+            row.jBegin = i + 1;
+            row.jEnd = end;
+
+            force += kernel(row);
+
+            forces.Set(i, force);
+        }
+    });
+}
+
+float CoulombFieldError(const Particles& particles, int begin, int end, const Vec3Array& field, int sampleCount) {
+    if (end <= begin || sampleCount <= 0) return 0.0f;
+
+    int stride = std::max(1, (end - begin) / sampleCount);
+
+    double error = 0.0;
+    double magnitude = 0.0;
+
+    for (int i = begin; i < end; i += stride) {
+        glm::dvec3 exact = DirectField(particles, begin, end, i);
+        glm::dvec3 difference = glm::dvec3{ field.x[i], field.y[i], field.z[i] } - exact;
+
+        error += glm::dot(difference, difference);
+        magnitude += glm::dot(exact, exact);
+    }
+
+    if (magnitude == 0.0) return 0.0f;
+
+    return (float)glm::sqrt(error / magnitude);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "ForceAccumulator.h"
+#include "Particles.h"
+
+enum class CoulombSolver {
+    Direct,
+    BarnesHut,
+    FastMultipole
+};
+
+// Direct sum of the Coulomb force between the particles in [begin, end). Each pair is evaluated
+// once and applied to both particles with opposite signs, using the row kernel for simdLevel.
+// forces is indexed like particles.
+void DirectCoulombForces(const Particles& particles, int begin, int end, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+// Direct sum of the Coulomb force on the targetCount particles in targets from every particle in
+// [begin, end), only their entries of forces are written. Each pair with a target is evaluated
+// from the target's side, so this beats DirectCoulombForces while under half the particles are targets.
+void DirectCoulombForcesOn(const Particles& particles, int begin, int end, const int* targets, int targetCount, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+// RMS relative error of an approximate Coulomb field (force per unit charge) against the direct
+// sum, sqrt(sum|E - E_direct|^2 / sum|E_direct|^2), over the particles in [begin, end). At most
+// sampleCount evenly spaced particles are checked so it stays affordable for large scenes.
+float CoulombFieldError(const Particles& particles, int begin, int end, const Vec3Array& field, int sampleCount);
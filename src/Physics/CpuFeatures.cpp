@@ -0,0 +1,80 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace {
+    void Cpuid(int leaf, int subleaf, unsigned int registers[4]) {
+#if defined(_MSC_VER)
+        int result[4];
+        __cpuidex(result, leaf, subleaf);
+
+        for (int i = 0; i < 4; ++i) registers[i] = (unsigned int)result[i];
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    // Register state the operating system saves on context switches
+    unsigned long long EnabledRegisterState() {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((unsigned long long)edx << 32) | eax;
+#endif
+    }
+}
+
+SimdLevel DetectSimdLevel() {
+    unsigned int registers[4];
+
+    Cpuid(0, 0, registers);
+    unsigned int maxLeaf = registers[0];
+
+    if (maxLeaf < 1) return SimdLevel::Scalar;
+
+    Cpuid(1, 0, registers);
+    unsigned int ecx1 = registers[2];
+
+    bool sse41 = ecx1 & (1u << 19);
+    bool fma = ecx1 & (1u << 12);
+    bool osxsave = ecx1 & (1u << 27);
+    bool avx = ecx1 & (1u << 28);
+
+    if (!sse41) return SimdLevel::Scalar;
+    if (!osxsave || !avx) return SimdLevel::Sse4;
+
+    unsigned long long state = EnabledRegisterState();
+
+    // XMM and YMM state
+    if ((state & 0x6) != 0x6 || maxLeaf < 7) return SimdLevel::Sse4;
+
+    Cpuid(7, 0, registers);
+    unsigned int ebx7 = registers[1];
+
+    bool avx2 = ebx7 & (1u << 5);
+    bool avx512f = ebx7 & (1u << 16);
+
+    if (!avx2 || !fma) return SimdLevel::Sse4;
+
+    // Opmask, upper ZMM and high ZMM state
+    if (avx512f && (state & 0xE6) == 0xE6) return SimdLevel::Avx512;
+
+    return SimdLevel::Avx2;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "Scalar";
+        case SimdLevel::Sse4: return "SSE4";
+        case SimdLevel::Avx2: return "AVX2";
+        case SimdLevel::Avx512: return "AVX-512";
+    }
+
+    return "Unknown";
+}
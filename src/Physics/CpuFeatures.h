@@ -0,0 +1,14 @@
+#pragma once
+
+// Instruction sets the pair kernels are compiled for, in increasing order
+enum class SimdLevel {
+    Scalar,
+    Sse4,
+    Avx2,
+    Avx512
+};
+
+// Highest level supported by both the processor and the operating system
+SimdLevel DetectSimdLevel();
+
+const char* SimdLevelName(SimdLevel level);
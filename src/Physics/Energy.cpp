@@ -0,0 +1,43 @@
+#include "Energy.h"
+
+#include <cmath>
+
+double NuclearPotential(double r) {
+    double r3 = r * r * r;
+
+    return 1.0 / (9.0 * r3 * r3 * r3) - std::exp(r) / r + 2.0 * std::expint(r);
+}
+
+double KineticEnergy(const Particles& particles) {
+    double energy = 0.0;
+
+    for (int i = 0; i < particles.Size(); ++i) {
+        double speedSquared = (double)particles.vx[i] * particles.vx[i] + (double)particles.vy[i] * particles.vy[i] + (double)particles.vz[i] * particles.vz[i];
+
+        energy += 0.5 * particles.mass[i] * speedSquared;
+    }
+
+    return energy;
+}
+
+double PotentialEnergy(const Particles& particles) {
+    const int chargedEnd = particles.ChargedEnd();
+    const int nucleonBegin = particles.NucleonBegin();
+
+    double energy = 0.0;
+
+    for (int i = 0; i < particles.Size(); ++i) {
+        for (int j = i + 1; j < particles.Size(); ++j) {
+            double dx = (double)particles.x[i] - particles.x[j];
+            double dy = (double)particles.y[i] - particles.y[j];
+            double dz = (double)particles.z[i] - particles.z[j];
+
+            double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+            if (j < chargedEnd) energy += (double)particles.charge[i] * particles.charge[j] / distance;
+            if (i >= nucleonBegin) energy += NuclearPotential(distance);
+        }
+    }
+
+    return energy;
+}
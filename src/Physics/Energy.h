@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Particles.h"
+
+// Potential of the nuclear force, F(r) = -dU/dr for F(r) = 1 / r^10 - (e^r / r^2 + e^r / r):
+//
+//   U(r) = 1 / (9 r^9) - e^r / r + 2 Ei(r)
+//
+// Ei is the exponential integral, so U is only defined up to the constant every pair shares.
+double NuclearPotential(double r);
+
+double KineticEnergy(const Particles& particles);
+
+// Coulomb and nuclear potential energy summed directly over every pair, in an open box
+double PotentialEnergy(const Particles& particles);
+
+inline double TotalEnergy(const Particles& particles) {
+    return KineticEnergy(particles) + PotentialEnergy(particles);
+}
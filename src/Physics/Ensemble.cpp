@@ -0,0 +1,291 @@
+#include "Ensemble.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+#include "Energy.h"
+#include "ForceAccumulator.h"
+#include "Integrator.h"
+#include "ReplicaBatch.h"
+#include "Scene.h"
+#include "SmallAtom.h"
+
+// Everything a replica needs while it runs, one per pool thread so nothing is shared
+struct Ensemble::Workspace {
+    // A pool of one thread runs the force sums inline on the thread running the replica
+    ThreadPool pool{ 1 };
+
+    PhysicsState state;
+    SmallAtom smallAtom;
+
+    ReplicaBatch batch;
+    std::array<PhysicsState, ReplicaBatch::MaxLaneCount> batchStates;
+
+    ForceAccumulator accumulator;
+    Vec3Array coulombForces;
+    Vec3Array nuclearForces;
+    Vec3Array forces;
+};
+
+namespace {
+    std::uint64_t SplitMix64(std::uint64_t& state) {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [-1, 1), from the top 24 bits so it is the same on every platform
+    float Symmetric(std::uint64_t& state) {
+        return (float)(SplitMix64(state) >> 40) * (2.0f / 16777216.0f) - 1.0f;
+    }
+
+    glm::vec3 Jitter(std::uint64_t& state, float amount) {
+        float x = Symmetric(state);
+        float y = Symmetric(state);
+        float z = Symmetric(state);
+
+        return glm::vec3{ x, y, z } * amount;
+    }
+
+    // Centre of mass of the nucleus, or of everything when there are no nucleons
+    glm::vec3 NucleusCentre(const Particles& particles) {
+        int begin = particles.NucleonBegin() < particles.Size() ? particles.NucleonBegin() : 0;
+
+        glm::vec3 centre{ 0.0f };
+        float totalMass = 0.0f;
+
+        for (int i = begin; i < particles.Size(); ++i) {
+            centre += particles.Position(i) * particles.mass[i];
+            totalMass += particles.mass[i];
+        }
+
+        return totalMass > 0.0f ? centre / totalMass : centre;
+    }
+
+    void CheckEscapes(const Particles& particles, float escapeDistance, float time, ReplicaResult& result) {
+        const glm::vec3 centre = NucleusCentre(particles);
+        const float escapeDistanceSquared = escapeDistance * escapeDistance;
+
+        result.escapedElectrons = 0;
+        result.escapedNucleons = 0;
+
+        for (int i = 0; i < particles.Size(); ++i) {
+            glm::vec3 offset = particles.Position(i) - centre;
+            if (glm::dot(offset, offset) <= escapeDistanceSquared) continue;
+
+            if (particles.species[i] == Species::Electron) ++result.escapedElectrons;
+            else ++result.escapedNucleons;
+        }
+
+        if (result.escapedElectrons > 0 && result.electronEscapeTime < 0.0f) result.electronEscapeTime = time;
+        if (result.escapedNucleons > 0 && result.nucleonEscapeTime < 0.0f) result.nucleonEscapeTime = time;
+    }
+}
+
+double ReplicaResult::RelativeEnergyDrift() const {
+    return std::abs(finalEnergy - initialEnergy) / std::max(std::abs(initialEnergy), 1e-30);
+}
+
+Ensemble::Ensemble() = default;
+Ensemble::~Ensemble() = default;
+
+void Ensemble::Run(ThreadPool& pool) {
+    while ((int)m_Workspaces.size() < pool.GetThreadCount()) {
+        m_Workspaces.push_back(std::make_unique<Workspace>());
+    }
+
+    m_Results.assign(std::max(replicaCount, 0), ReplicaResult{ });
+    m_Completed.store(0, std::memory_order_relaxed);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const int lanes = ReplicaBatch::LaneCount(simdLevel);
+
+    if (batchReplicas && lanes > 1) {
+        const int batchCount = ((int)m_Results.size() + lanes - 1) / lanes;
+
+        pool.Run(batchCount, [&](int batch, int thread) {
+            RunBatch(batch * lanes, *m_Workspaces[thread]);
+        });
+    }
+    else {
+        // One task per replica, stealing evens out replicas that run at different speeds
+        pool.Run((int)m_Results.size(), [&](int replica, int thread) {
+            RunReplica(replica, *m_Workspaces[thread]);
+
+            m_Completed.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    m_RunTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::uint64_t Ensemble::ReplicaSeed(int replica) const {
+    std::uint64_t state = seed ^ ((std::uint64_t)replica * 0xD1B54A32D192ED03ull);
+
+    return SplitMix64(state);
+}
+
+PhysicsState Ensemble::MakeReplica(int replica) const {
+    PhysicsState state{ };
+    AddToState(state, neutronCount, protonCount, electronCount);
+
+    Particles& particles = state.particles;
+    std::uint64_t random = ReplicaSeed(replica);
+
+    for (int i = 0; i < particles.Size(); ++i) {
+        glm::vec3 position = particles.Position(i) + Jitter(random, positionJitter);
+        glm::vec3 velocity = Jitter(random, velocityJitter);
+
+        particles.x[i] = position.x;
+        particles.y[i] = position.y;
+        particles.z[i] = position.z;
+
+        particles.vx[i] = velocity.x;
+        particles.vy[i] = velocity.y;
+        particles.vz[i] = velocity.z;
+    }
+
+    return state;
+}
+
+void Ensemble::RunReplica(int replica, Workspace& workspace) {
+    ReplicaResult& result = m_Results[replica];
+    result.seed = ReplicaSeed(replica);
+
+    workspace.state = MakeReplica(replica);
+
+    Particles& particles = workspace.state.particles;
+    ThreadPool& pool = workspace.pool;
+
+    auto computeForces = [&]() {
+        DirectForces(particles, workspace.accumulator, pool, simdLevel, workspace.coulombForces, workspace.nuclearForces, workspace.forces);
+    };
+
+    result.initialEnergy = TotalEnergy(particles);
+
+    const bool small = workspace.smallAtom.Load(particles);
+    if (!small) computeForces();
+
+    const int interval = std::max(checkInterval, 1);
+
+    for (int step = 0; step < stepCount && !m_Cancelled.load(std::memory_order_relaxed); step += interval) {
+        const int steps = std::min(interval, stepCount - step);
+
+        if (small) {
+            workspace.smallAtom.Step(timeStep, steps);
+            workspace.smallAtom.Store(particles);
+        }
+        else {
+            for (int i = 0; i < steps; ++i) {
+                Kick(particles, 0, particles.Size(), workspace.forces, 0.5f * timeStep, pool);
+                Drift(particles, 0, particles.Size(), timeStep, false, 0.0f, pool);
+
+                computeForces();
+
+                Kick(particles, 0, particles.Size(), workspace.forces, 0.5f * timeStep, pool);
+            }
+        }
+
+        result.stepCount = step + steps;
+
+        CheckEscapes(particles, escapeDistance, (float)result.stepCount * timeStep, result);
+    }
+
+    result.finalEnergy = TotalEnergy(particles);
+}
+
+void Ensemble::RunBatch(int firstReplica, Workspace& workspace) {
+    const int count = std::min(ReplicaBatch::LaneCount(simdLevel), (int)m_Results.size() - firstReplica);
+
+    std::array<const Particles*, ReplicaBatch::MaxLaneCount> replicas{ };
+
+    for (int lane = 0; lane < count; ++lane) {
+        ReplicaResult& result = m_Results[firstReplica + lane];
+        result.seed = ReplicaSeed(firstReplica + lane);
+
+        workspace.batchStates[lane] = MakeReplica(firstReplica + lane);
+        replicas[lane] = &workspace.batchStates[lane].particles;
+
+        result.initialEnergy = TotalEnergy(*replicas[lane]);
+    }
+
+    workspace.batch.Load(replicas.data(), count, simdLevel);
+
+    const int interval = std::max(checkInterval, 1);
+
+    for (int step = 0; step < stepCount && !m_Cancelled.load(std::memory_order_relaxed); step += interval) {
+        const int steps = std::min(interval, stepCount - step);
+
+        workspace.batch.Step(timeStep, steps);
+
+        for (int lane = 0; lane < count; ++lane) {
+            ReplicaResult& result = m_Results[firstReplica + lane];
+            Particles& particles = workspace.batchStates[lane].particles;
+
+            workspace.batch.Store(lane, particles);
+            result.stepCount = step + steps;
+
+            CheckEscapes(particles, escapeDistance, (float)result.stepCount * timeStep, result);
+        }
+    }
+
+    for (int lane = 0; lane < count; ++lane) {
+        m_Results[firstReplica + lane].finalEnergy = TotalEnergy(workspace.batchStates[lane].particles);
+    }
+
+    m_Completed.fetch_add(count, std::memory_order_relaxed);
+}
+
+EnsembleStatistics Ensemble::GetStatistics() const {
+    EnsembleStatistics statistics{ };
+    statistics.replicaCount = (int)m_Results.size();
+
+    if (m_Results.empty()) return statistics;
+
+    std::vector<float> electronEscapeTimes;
+    int brokenCount = 0;
+    double nucleonEscapeTimeSum = 0.0;
+    double energyDriftSum = 0.0;
+    double stepSum = 0.0;
+
+    for (const ReplicaResult& result : m_Results) {
+        stepSum += result.stepCount;
+
+        if (result.electronEscapeTime >= 0.0f) electronEscapeTimes.push_back(result.electronEscapeTime);
+
+        if (result.nucleonEscapeTime >= 0.0f) {
+            ++brokenCount;
+            nucleonEscapeTimeSum += result.nucleonEscapeTime;
+        }
+
+        double drift = result.RelativeEnergyDrift();
+        energyDriftSum += drift;
+        statistics.maxEnergyDrift = std::max(statistics.maxEnergyDrift, drift);
+    }
+
+    const float replicas = (float)m_Results.size();
+
+    statistics.ionizedFraction = (float)electronEscapeTimes.size() / replicas;
+    statistics.brokenFraction = (float)brokenCount / replicas;
+    statistics.meanEnergyDrift = energyDriftSum / replicas;
+
+    if (!electronEscapeTimes.empty()) {
+        double sum = 0.0;
+        for (float time : electronEscapeTimes) sum += time;
+
+        statistics.meanElectronEscapeTime = (float)(sum / electronEscapeTimes.size());
+
+        std::sort(electronEscapeTimes.begin(), electronEscapeTimes.end());
+        statistics.medianElectronEscapeTime = electronEscapeTimes[electronEscapeTimes.size() / 2];
+    }
+
+    if (brokenCount > 0) statistics.meanNucleonEscapeTime = (float)(nucleonEscapeTimeSum / brokenCount);
+
+    if (m_RunTime > 0.0) statistics.stepsPerSecond = stepSum / m_RunTime;
+
+    return statistics;
+}
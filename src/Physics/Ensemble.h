@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "PhysicsState.h"
+#include "ThreadPool.h"
+
+// Outcome of one replica of an ensemble run
+struct ReplicaResult {
+    std::uint64_t seed{ 0 };
+
+    // Steps taken, short of the ensemble's step count if the run was cancelled
+    int stepCount{ 0 };
+
+    // Simulated time of the first check that found an electron (nucleon) further than the escape
+    // distance from the centre of mass of the nucleus, negative if none ever was
+    float electronEscapeTime{ -1.0f };
+    float nucleonEscapeTime{ -1.0f };
+
+    // Particles beyond the escape distance at the end of the run
+    int escapedElectrons{ 0 };
+    int escapedNucleons{ 0 };
+
+    double initialEnergy{ 0.0 };
+    double finalEnergy{ 0.0 };
+
+    // |E_end - E_start| / |E_start|
+    double RelativeEnergyDrift() const;
+};
+
+struct EnsembleStatistics {
+    int replicaCount{ 0 };
+
+    // Fraction of replicas that lost an electron, and when, over the replicas that did
+    float ionizedFraction{ 0.0f };
+    float meanElectronEscapeTime{ 0.0f };
+    float medianElectronEscapeTime{ 0.0f };
+
+    // Fraction of replicas whose nucleus lost a nucleon, and when, over the replicas that did
+    float brokenFraction{ 0.0f };
+    float meanNucleonEscapeTime{ 0.0f };
+
+    double meanEnergyDrift{ 0.0 };
+    double maxEnergyDrift{ 0.0 };
+
+    // Replica steps per second of wall clock time over the whole run
+    double stepsPerSecond{ 0.0 };
+};
+
+// Runs many independent copies of the same atom without rendering, to gather statistics on
+// ionization and the stability of the nucleus.
+//
+// Every replica starts from the scene builder's lattice with its positions and velocities
+// perturbed by a random generator seeded from the ensemble seed and the replica index, so any
+// replica can be rerun on its own. Replicas are stepped with velocity Verlet and the direct sums,
+// a register's worth at a time through ReplicaBatch, or one by one through SmallAtom when it fits
+// and the general path otherwise. Each replica or batch runs on a single thread and they are
+// spread over the pool, so all cores are busy without the sums of one atom being split into tiny
+// tasks. Results therefore do not depend on the number of threads.
+class Ensemble {
+public:
+    int protonCount{ 1 };
+    int neutronCount{ 0 };
+    int electronCount{ 1 };
+
+    int replicaCount{ 1024 };
+    std::uint64_t seed{ 1 };
+
+    // Largest perturbation of each component, added uniformly in [-jitter, jitter]
+    float positionJitter{ 0.05f };
+    float velocityJitter{ 0.05f };
+
+    float timeStep{ 0.001f };
+    int stepCount{ 100000 };
+
+    // Steps between escape checks, which also sets the resolution of the escape times
+    int checkInterval{ 100 };
+    float escapeDistance{ 20.0f };
+
+    SimdLevel simdLevel{ SimdLevel::Scalar };
+
+    // Step replicas in batches of one per vector lane, when simdLevel has more than one lane
+    bool batchReplicas{ true };
+
+    Ensemble();
+    ~Ensemble();
+
+    // Runs every replica to the end, blocking until all of them have finished. After a Cancel that
+    // has not been Reset every replica stops before its first step
+    void Run(ThreadPool& pool);
+
+    // Clears a previous Cancel, call before starting the thread that runs the ensemble
+    void Reset() { m_Cancelled.store(false, std::memory_order_relaxed); }
+
+    // Makes a Run on another thread stop its replicas at their next escape check and return
+    void Cancel() { m_Cancelled.store(true, std::memory_order_relaxed); }
+
+    // Starting state of a replica
+    PhysicsState MakeReplica(int replica) const;
+
+    std::uint64_t ReplicaSeed(int replica) const;
+
+    // Replicas finished by the current or last Run, safe to read from another thread
+    int GetCompletedCount() const { return m_Completed.load(std::memory_order_relaxed); }
+
+    const std::vector<ReplicaResult>& GetResults() const { return m_Results; }
+
+    EnsembleStatistics GetStatistics() const;
+
+private:
+    struct Workspace;
+
+    void RunReplica(int replica, Workspace& workspace);
+    void RunBatch(int firstReplica, Workspace& workspace);
+
+    std::vector<std::unique_ptr<Workspace>> m_Workspaces;
+    std::vector<ReplicaResult> m_Results;
+    std::atomic<int> m_Completed{ 0 };
+    std::atomic<bool> m_Cancelled{ false };
+    double m_RunTime{ 0.0 };
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "Arena.h"
+#include "Parallel.h"
+
+// In place radix-2 FFT of n (a power of two) values spaced stride apart. Unnormalized in both
+// directions, a forward transform followed by an inverse one scales the input by n.
+inline void FFT(std::complex<double>* data, int n, int stride, bool inverse) {
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+
+        if (i < j) std::swap(data[i * stride], data[j * stride]);
+    }
+
+    const double pi = 3.14159265358979323846;
+
+    for (int length = 2; length <= n; length <<= 1) {
+        double angle = 2.0 * pi / length * (inverse ? -1.0 : 1.0);
+        std::complex<double> root{ std::cos(angle), std::sin(angle) };
+
+        for (int i = 0; i < n; i += length) {
+            std::complex<double> w{ 1.0 };
+
+            for (int k = 0; k < length / 2; ++k) {
+                std::complex<double> even = data[(i + k) * stride];
+                std::complex<double> odd = data[(i + k + length / 2) * stride] * w;
+
+                data[(i + k) * stride] = even + odd;
+                data[(i + k + length / 2) * stride] = even - odd;
+
+                w *= root;
+            }
+        }
+    }
+}
+
+// 3D FFT of an n * n * n grid stored x fastest, lines along each axis are split across tasks
+inline void FFT3D(std::vector<std::complex<double>>& grid, int n, bool inverse, ThreadPool& pool) {
+    // x lines are contiguous
+    ParallelFor(pool, n * n, [&](int begin, int end, int) {
+        for (int line = begin; line < end; ++line) {
+            FFT(&grid[(size_t)line * n], n, 1, inverse);
+        }
+    });
+
+    // y and z lines are strided, gather each one into a contiguous buffer first
+    ParallelFor(pool, n * n, [&](int begin, int end, int) {
+        ScratchScope scratch{ };
+        std::complex<double>* buffer = scratch.Allocate<std::complex<double>>(n);
+
+        for (int line = begin; line < end; ++line) {
+            int x = line % n;
+            int z = line / n;
+
+            for (int y = 0; y < n; ++y) buffer[y] = grid[((size_t)z * n + y) * n + x];
+            FFT(buffer, n, 1, inverse);
+            for (int y = 0; y < n; ++y) grid[((size_t)z * n + y) * n + x] = buffer[y];
+        }
+    });
+
+    ParallelFor(pool, n * n, [&](int begin, int end, int) {
+        ScratchScope scratch{ };
+        std::complex<double>* buffer = scratch.Allocate<std::complex<double>>(n);
+
+        for (int line = begin; line < end; ++line) {
+            int x = line % n;
+            int y = line / n;
+
+            for (int z = 0; z < n; ++z) buffer[z] = grid[((size_t)z * n + y) * n + x];
+            FFT(buffer, n, 1, inverse);
+            for (int z = 0; z < n; ++z) grid[((size_t)z * n + y) * n + x] = buffer[z];
+        }
+    });
+}
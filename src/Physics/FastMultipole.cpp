@@ -0,0 +1,581 @@
+#include "FastMultipole.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Parallel.h"
+
+// Expansions follow the spherical harmonic formulation used by exafmm. Coefficients are stored
+// for m >= 0 only (index n * (n + 1) / 2 + m), harmonics for the full -n..n range
+// (index n * n + n + m).
+
+namespace {
+    using Complex = std::complex<double>;
+
+    const Complex I{ 0.0, 1.0 };
+
+    double OddEven(int n) { return (n & 1) ? -1.0 : 1.0; }
+    double IPow2N(int n) { return n >= 0 ? 1.0 : OddEven(n); }
+
+    void CartesianToSpherical(const glm::dvec3& d, double& r, double& theta, double& phi) {
+        r = std::sqrt(glm::dot(d, d));
+        theta = r == 0.0 ? 0.0 : std::acos(std::clamp(d.z / r, -1.0, 1.0));
+        phi = std::atan2(d.y, d.x);
+    }
+
+    // Regular harmonics r^n Y_n^m, and their theta derivative
+    void EvaluateMultipole(int order, double rho, double alpha, double beta, Complex* Ynm, Complex* YnmTheta) {
+        double x = std::cos(alpha);
+        double y = std::sin(alpha);
+        double inverseY = y == 0.0 ? 0.0 : 1.0 / y;
+        double fact = 1.0;
+        double pn = 1.0;
+        double rhom = 1.0;
+        Complex ei = std::exp(I * beta);
+        Complex eim = 1.0;
+
+        for (int m = 0; m < order; ++m) {
+            double p = pn;
+            int npn = m * m + 2 * m;
+            int nmn = m * m;
+            Ynm[npn] = rhom * p * eim;
+            Ynm[nmn] = std::conj(Ynm[npn]);
+            double p1 = p;
+            p = x * (2 * m + 1) * p1;
+            YnmTheta[npn] = rhom * (p - (m + 1) * x * p1) * inverseY * eim;
+            rhom *= rho;
+            double rhon = rhom;
+
+            for (int n = m + 1; n < order; ++n) {
+                int npm = n * n + n + m;
+                int nmm = n * n + n - m;
+                rhon /= -(n + m);
+                Ynm[npm] = rhon * p * eim;
+                Ynm[nmm] = std::conj(Ynm[npm]);
+                double p2 = p1;
+                p1 = p;
+                p = (x * (2 * n + 1) * p1 - (n + m) * p2) / (n - m + 1);
+                YnmTheta[npm] = rhon * ((n - m + 1) * p - (n + 1) * x * p1) * inverseY * eim;
+                rhon *= rho;
+            }
+
+            rhom /= -(2 * m + 2) * (2 * m + 1);
+            pn = -pn * fact * y;
+            fact += 2.0;
+            eim *= ei;
+        }
+    }
+
+    // Irregular harmonics Y_n^m / r^(n + 1)
+    void EvaluateLocal(int order, double rho, double alpha, double beta, Complex* Ynm) {
+        double x = std::cos(alpha);
+        double y = std::sin(alpha);
+        double fact = 1.0;
+        double pn = 1.0;
+        double inverseR = -1.0 / rho;
+        double rhom = -inverseR;
+        Complex ei = std::exp(I * beta);
+        Complex eim = 1.0;
+
+        for (int m = 0; m < order; ++m) {
+            double p = pn;
+            int npn = m * m + 2 * m;
+            int nmn = m * m;
+            Ynm[npn] = rhom * p * eim;
+            Ynm[nmn] = std::conj(Ynm[npn]);
+            double p1 = p;
+            p = x * (2 * m + 1) * p1;
+            rhom *= inverseR;
+            double rhon = rhom;
+
+            for (int n = m + 1; n < order; ++n) {
+                int npm = n * n + n + m;
+                int nmm = n * n + n - m;
+                Ynm[npm] = rhon * p * eim;
+                Ynm[nmm] = std::conj(Ynm[npm]);
+                double p2 = p1;
+                p1 = p;
+                p = (x * (2 * n + 1) * p1 - (n + m) * p2) / (n - m + 1);
+                rhon *= inverseR * (n - m + 1);
+            }
+
+            pn = -pn * fact * y;
+            fact += 2.0;
+            eim *= ei;
+        }
+    }
+}
+
+void FastMultipole::Evaluate(const Particles& particles, int begin, int end, ThreadPool& pool, Vec3Array& field) {
+    m_Particles = &particles;
+    m_Begin = begin;
+
+    const int count = end - begin;
+
+    field.Assign(particles.Size());
+
+    if (count <= 0) return;
+
+    order = std::max(order, 1);
+    m_TermCount = order * (order + 1) / 2;
+
+    m_Field.assign(count, glm::dvec3{ 0.0 });
+
+    Build();
+
+    const int cellCount = (int)m_Cells.size();
+
+    m_Multipoles.assign((size_t)cellCount * m_TermCount, Complex{ 0.0 });
+    m_Locals.assign((size_t)cellCount * m_TermCount, Complex{ 0.0 });
+
+    m_Leaves.clear();
+    for (int i = 0; i < cellCount; ++i) {
+        if (m_Cells[i].firstChild == -1) m_Leaves.push_back(i);
+    }
+
+    // Enough workspaces for the largest of the parallel loops below
+    m_Workspaces.resize(ParallelTaskCount(pool, std::max(cellCount, 1)));
+    for (Workspace& workspace : m_Workspaces) {
+        workspace.ynm.resize((size_t)order * order);
+        workspace.ynmTheta.resize((size_t)order * order);
+        workspace.shifted.resize(m_TermCount);
+    }
+
+    ParallelFor(pool, (int)m_Leaves.size(), [&](int rangeBegin, int rangeEnd, int task) {
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            P2M(m_Leaves[i], m_Workspaces[task]);
+        }
+    });
+
+    // Children are always stored after their parent, so a reverse sweep is a post-order traversal
+    for (int i = cellCount - 1; i >= 0; --i) {
+        if (m_Cells[i].firstChild != -1) M2M(i, m_Workspaces[0]);
+    }
+
+    m_Traversal.clear();
+    Interact(0, 0);
+
+    // Group the interactions by target, keeping the traversal order within each target so the
+    // sums do not depend on the thread count
+    m_InteractionOffsets.assign(cellCount + 1, 0);
+    for (const Interaction& interaction : m_Traversal) {
+        ++m_InteractionOffsets[interaction.target + 1];
+    }
+
+    for (int i = 0; i < cellCount; ++i) {
+        m_InteractionOffsets[i + 1] += m_InteractionOffsets[i];
+    }
+
+    m_Interactions.resize(m_Traversal.size());
+    m_Scratch.assign(m_InteractionOffsets.begin(), m_InteractionOffsets.end() - 1);
+    for (const Interaction& interaction : m_Traversal) {
+        m_Interactions[m_Scratch[interaction.target]++] = interaction;
+    }
+
+    // Each task only writes the locals of its own target cells and the field of the charges in
+    // them, P2P targets are always leaves so no charge belongs to two of them
+    ParallelFor(pool, cellCount, [&](int cellBegin, int cellEnd, int task) {
+        for (int n = m_InteractionOffsets[cellBegin]; n < m_InteractionOffsets[cellEnd]; ++n) {
+            const Interaction& interaction = m_Interactions[n];
+
+            if (interaction.far) M2L(interaction.target, interaction.source, m_Workspaces[task]);
+            else P2P(interaction.target, interaction.source);
+        }
+    });
+
+    for (int i = 0; i < cellCount; ++i) {
+        if (m_Cells[i].firstChild != -1) L2L(i, m_Workspaces[0]);
+    }
+
+    ParallelFor(pool, (int)m_Leaves.size(), [&](int rangeBegin, int rangeEnd, int task) {
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            L2P(m_Leaves[i], m_Workspaces[task]);
+        }
+    });
+
+    for (int i = 0; i < count; ++i) {
+        field.x[begin + i] = (float)m_Field[i].x;
+        field.y[begin + i] = (float)m_Field[i].y;
+        field.z[begin + i] = (float)m_Field[i].z;
+    }
+}
+
+void FastMultipole::Build() {
+    const Particles& particles = *m_Particles;
+    const int count = (int)m_Field.size();
+
+    m_Cells.clear();
+    m_Indices.resize(count);
+    m_Scratch.resize(count);
+    m_Positions.resize(count);
+    m_Charges.resize(count);
+
+    for (int i = 0; i < count; ++i) {
+        int index = m_Begin + i;
+
+        m_Indices[i] = i;
+        m_Positions[i] = glm::dvec3{ particles.x[index], particles.y[index], particles.z[index] };
+        m_Charges[i] = particles.charge[index];
+    }
+
+    glm::dvec3 minimum{ m_Positions[0] };
+    glm::dvec3 maximum{ minimum };
+
+    for (int i = 0; i < count; ++i) {
+        minimum = glm::min(minimum, m_Positions[i]);
+        maximum = glm::max(maximum, m_Positions[i]);
+    }
+
+    glm::dvec3 extent = maximum - minimum;
+    double halfSize = std::max(extent.x, std::max(extent.y, extent.z)) * 0.5;
+    halfSize = halfSize * 1.0001 + 1e-6;
+
+    Cell root{ };
+    root.center = (minimum + maximum) * 0.5;
+    root.halfSize = halfSize;
+    root.firstChild = -1;
+    root.begin = 0;
+    root.count = count;
+
+    m_Cells.push_back(root);
+
+    Split(0, 0);
+
+    for (Cell& cell : m_Cells) {
+        double radius = 0.0;
+
+        for (int i = cell.begin; i < cell.begin + cell.count; ++i) {
+            glm::dvec3 d = m_Positions[m_Indices[i]] - cell.center;
+            radius = std::max(radius, glm::dot(d, d));
+        }
+
+        cell.radius = std::sqrt(radius);
+    }
+}
+
+void FastMultipole::Split(int cellIndex, int depth) {
+    if (m_Cells[cellIndex].count <= leafCapacity || depth >= maxDepth) return;
+
+    Cell cell = m_Cells[cellIndex];
+
+    auto octantOf = [&](int index) {
+        const glm::dvec3& p = m_Positions[index];
+        return (p.x >= cell.center.x ? 1 : 0) | (p.y >= cell.center.y ? 2 : 0) | (p.z >= cell.center.z ? 4 : 0);
+    };
+
+    std::array<int, 8> counts{ };
+    for (int i = cell.begin; i < cell.begin + cell.count; ++i) {
+        ++counts[octantOf(m_Indices[i])];
+    }
+
+    std::array<int, 8> offsets{ };
+    offsets[0] = cell.begin;
+    for (int o = 1; o < 8; ++o) {
+        offsets[o] = offsets[o - 1] + counts[o - 1];
+    }
+
+    std::array<int, 8> cursor = offsets;
+    for (int i = cell.begin; i < cell.begin + cell.count; ++i) {
+        m_Scratch[cursor[octantOf(m_Indices[i])]++] = m_Indices[i];
+    }
+
+    std::copy(m_Scratch.begin() + cell.begin, m_Scratch.begin() + cell.begin + cell.count, m_Indices.begin() + cell.begin);
+
+    int firstChild = (int)m_Cells.size();
+    int childCount = 0;
+
+    double childHalfSize = cell.halfSize * 0.5;
+    for (int o = 0; o < 8; ++o) {
+        if (counts[o] == 0) continue;
+
+        Cell child{ };
+        child.center = cell.center + glm::dvec3{
+            (o & 1) ? childHalfSize : -childHalfSize,
+            (o & 2) ? childHalfSize : -childHalfSize,
+            (o & 4) ? childHalfSize : -childHalfSize
+        };
+        child.halfSize = childHalfSize;
+        child.firstChild = -1;
+        child.begin = offsets[o];
+        child.count = counts[o];
+
+        m_Cells.push_back(child);
+        ++childCount;
+    }
+
+    m_Cells[cellIndex].firstChild = firstChild;
+    m_Cells[cellIndex].childCount = childCount;
+
+    for (int c = 0; c < childCount; ++c) {
+        Split(firstChild + c, depth + 1);
+    }
+}
+
+void FastMultipole::P2M(int cellIndex, Workspace& workspace) {
+    const Cell& cell = m_Cells[cellIndex];
+
+    Complex* M = Multipole(cellIndex);
+
+    for (int i = cell.begin; i < cell.begin + cell.count; ++i) {
+        int index = m_Indices[i];
+
+        double rho, alpha, beta;
+        CartesianToSpherical(m_Positions[index] - cell.center, rho, alpha, beta);
+        EvaluateMultipole(order, rho, alpha, -beta, workspace.ynm.data(), workspace.ynmTheta.data());
+
+        double charge = m_Charges[index];
+
+        for (int n = 0; n < order; ++n) {
+            for (int m = 0; m <= n; ++m) {
+                M[n * (n + 1) / 2 + m] += charge * workspace.ynm[n * n + n + m];
+            }
+        }
+    }
+}
+
+void FastMultipole::M2M(int parentIndex, Workspace& workspace) {
+    const Cell& parent = m_Cells[parentIndex];
+
+    Complex* Mi = Multipole(parentIndex);
+
+    for (int c = parent.firstChild; c < parent.firstChild + parent.childCount; ++c) {
+        const Complex* Mj = Multipole(c);
+
+        double rho, alpha, beta;
+        CartesianToSpherical(parent.center - m_Cells[c].center, rho, alpha, beta);
+        EvaluateMultipole(order, rho, alpha, beta, workspace.ynm.data(), workspace.ynmTheta.data());
+
+        for (int j = 0; j < order; ++j) {
+            for (int k = 0; k <= j; ++k) {
+                Complex M{ 0.0 };
+
+                for (int n = 0; n <= j; ++n) {
+                    for (int m = std::max(-n, -j + k + n); m <= std::min(k - 1, n); ++m) {
+                        int jnkms = (j - n) * (j - n + 1) / 2 + k - m;
+                        int nm = n * n + n - m;
+                        M += Mj[jnkms] * workspace.ynm[nm] * (IPow2N(m) * OddEven(n));
+                    }
+
+                    for (int m = k; m <= std::min(n, j + k - n); ++m) {
+                        int jnkms = (j - n) * (j - n + 1) / 2 - k + m;
+                        int nm = n * n + n - m;
+                        M += std::conj(Mj[jnkms]) * workspace.ynm[nm] * OddEven(k + n + m);
+                    }
+                }
+
+                Mi[j * (j + 1) / 2 + k] += M;
+            }
+        }
+    }
+}
+
+void FastMultipole::M2L(int targetIndex, int sourceIndex, Workspace& workspace) {
+    const Complex* Mj = Multipole(sourceIndex);
+    Complex* Li = Local(targetIndex);
+
+    double rho, alpha, beta;
+    CartesianToSpherical(m_Cells[targetIndex].center - m_Cells[sourceIndex].center, rho, alpha, beta);
+    EvaluateLocal(order, rho, alpha, beta, workspace.ynm.data());
+
+    for (int j = 0; j < order; ++j) {
+        double Cnm = OddEven(j);
+
+        for (int k = 0; k <= j; ++k) {
+            Complex L{ 0.0 };
+
+            for (int n = 0; n < order - j; ++n) {
+                for (int m = -n; m < 0; ++m) {
+                    int nms = n * (n + 1) / 2 - m;
+                    int jnkm = (j + n) * (j + n) + j + n + m - k;
+                    L += std::conj(Mj[nms]) * Cnm * workspace.ynm[jnkm];
+                }
+
+                for (int m = 0; m <= n; ++m) {
+                    int nms = n * (n + 1) / 2 + m;
+                    int jnkm = (j + n) * (j + n) + j + n + m - k;
+                    L += Mj[nms] * (Cnm * OddEven((k - m) * (k < m) + m)) * workspace.ynm[jnkm];
+                }
+            }
+
+            Li[j * (j + 1) / 2 + k] += L;
+        }
+    }
+}
+
+void FastMultipole::L2L(int parentIndex, Workspace& workspace) {
+    const Cell& parent = m_Cells[parentIndex];
+
+    const Complex* Lj = Local(parentIndex);
+
+    for (int c = parent.firstChild; c < parent.firstChild + parent.childCount; ++c) {
+        Complex* Li = Local(c);
+
+        double rho, alpha, beta;
+        CartesianToSpherical(m_Cells[c].center - parent.center, rho, alpha, beta);
+        EvaluateMultipole(order, rho, alpha, beta, workspace.ynm.data(), workspace.ynmTheta.data());
+
+        for (int j = 0; j < order; ++j) {
+            for (int k = 0; k <= j; ++k) {
+                Complex L{ 0.0 };
+
+                for (int n = j; n < order; ++n) {
+                    for (int m = j + k - n; m < 0; ++m) {
+                        int jnkm = (n - j) * (n - j) + n - j + m - k;
+                        int nms = n * (n + 1) / 2 - m;
+                        L += std::conj(Lj[nms]) * workspace.ynm[jnkm] * OddEven(k);
+                    }
+
+                    for (int m = 0; m <= n; ++m) {
+                        if (n - j < std::abs(m - k)) continue;
+
+                        int jnkm = (n - j) * (n - j) + n - j + m - k;
+                        int nms = n * (n + 1) / 2 + m;
+                        L += Lj[nms] * workspace.ynm[jnkm] * OddEven((m - k) * (m < k));
+                    }
+                }
+
+                Li[j * (j + 1) / 2 + k] += L;
+            }
+        }
+    }
+}
+
+void FastMultipole::L2P(int cellIndex, Workspace& workspace) {
+    const Cell& cell = m_Cells[cellIndex];
+
+    for (int i = cell.begin; i < cell.begin + cell.count; ++i) {
+        int index = m_Indices[i];
+
+        glm::dvec3 d = m_Positions[index] - cell.center;
+
+        // The spherical gradient is singular on the z axis of the expansion. A local expansion is
+        // a polynomial so it can be re-centred exactly, evaluate from a nearby off-axis centre instead.
+        const Complex* L = Local(cellIndex);
+
+        double offAxis = std::sqrt(d.x * d.x + d.y * d.y);
+        if (offAxis < 1e-6 * cell.halfSize) {
+            glm::dvec3 shift{ 0.25 * cell.halfSize, 0.25 * cell.halfSize, 0.0 };
+
+            double rho, alpha, beta;
+            CartesianToSpherical(-shift, rho, alpha, beta);
+            EvaluateMultipole(order, rho, alpha, beta, workspace.ynm.data(), workspace.ynmTheta.data());
+
+            for (int j = 0; j < order; ++j) {
+                for (int k = 0; k <= j; ++k) {
+                    Complex shifted{ 0.0 };
+
+                    for (int n = j; n < order; ++n) {
+                        for (int m = j + k - n; m < 0; ++m) {
+                            shifted += std::conj(L[n * (n + 1) / 2 - m]) * workspace.ynm[(n - j) * (n - j) + n - j + m - k] * OddEven(k);
+                        }
+
+                        for (int m = 0; m <= n; ++m) {
+                            if (n - j < std::abs(m - k)) continue;
+
+                            shifted += L[n * (n + 1) / 2 + m] * workspace.ynm[(n - j) * (n - j) + n - j + m - k] * OddEven((m - k) * (m < k));
+                        }
+                    }
+
+                    workspace.shifted[j * (j + 1) / 2 + k] = shifted;
+                }
+            }
+
+            L = workspace.shifted.data();
+            d += shift;
+        }
+
+        double r, theta, phi;
+        CartesianToSpherical(d, r, theta, phi);
+        EvaluateMultipole(order, r, theta, phi, workspace.ynm.data(), workspace.ynmTheta.data());
+
+        glm::dvec3 spherical{ 0.0 };
+
+        for (int n = 0; n < order; ++n) {
+            int nm = n * n + n;
+            int nms = n * (n + 1) / 2;
+
+            spherical.x += std::real(L[nms] * workspace.ynm[nm]) / r * n;
+            spherical.y += std::real(L[nms] * workspace.ynmTheta[nm]);
+
+            for (int m = 1; m <= n; ++m) {
+                nm = n * n + n + m;
+                nms = n * (n + 1) / 2 + m;
+
+                spherical.x += 2.0 * std::real(L[nms] * workspace.ynm[nm]) / r * n;
+                spherical.y += 2.0 * std::real(L[nms] * workspace.ynmTheta[nm]);
+                spherical.z += 2.0 * std::real(L[nms] * workspace.ynm[nm] * I) * m;
+            }
+        }
+
+        double sinTheta = std::sin(theta);
+        double cosTheta = std::cos(theta);
+        double sinPhi = std::sin(phi);
+        double cosPhi = std::cos(phi);
+
+        glm::dvec3 gradient{
+            sinTheta * cosPhi * spherical.x + cosTheta * cosPhi / r * spherical.y - sinPhi / r / sinTheta * spherical.z,
+            sinTheta * sinPhi * spherical.x + cosTheta * sinPhi / r * spherical.y + cosPhi / r / sinTheta * spherical.z,
+            cosTheta * spherical.x - sinTheta / r * spherical.y
+        };
+
+        // The field is minus the gradient of the potential
+        m_Field[index] -= gradient;
+    }
+}
+
+void FastMultipole::P2P(int targetIndex, int sourceIndex) {
+    const Cell& target = m_Cells[targetIndex];
+    const Cell& source = m_Cells[sourceIndex];
+
+    for (int i = target.begin; i < target.begin + target.count; ++i) {
+        int ti = m_Indices[i];
+        glm::dvec3 field{ 0.0 };
+
+        for (int j = source.begin; j < source.begin + source.count; ++j) {
+            int si = m_Indices[j];
+            if (si == ti) continue;
+
+            glm::dvec3 r = m_Positions[ti] - m_Positions[si];
+            double distanceSquared = glm::dot(r, r);
+            double inverseDistance = 1.0 / std::sqrt(distanceSquared);
+
+            field += (m_Charges[si] * inverseDistance * inverseDistance * inverseDistance) * r;
+        }
+
+        m_Field[ti] += field;
+    }
+}
+
+void FastMultipole::Interact(int targetIndex, int sourceIndex) {
+    const Cell& target = m_Cells[targetIndex];
+    const Cell& source = m_Cells[sourceIndex];
+
+    glm::dvec3 d = target.center - source.center;
+    double distanceSquared = glm::dot(d, d);
+    double radii = target.radius + source.radius;
+
+    if (radii * radii < (double)theta * theta * distanceSquared) {
+        m_Traversal.push_back(Interaction{ targetIndex, sourceIndex, true });
+        return;
+    }
+
+    bool targetLeaf = target.firstChild == -1;
+    bool sourceLeaf = source.firstChild == -1;
+
+    if (targetLeaf && sourceLeaf) {
+        m_Traversal.push_back(Interaction{ targetIndex, sourceIndex, false });
+        return;
+    }
+
+    if (sourceLeaf || (!targetLeaf && target.radius >= source.radius)) {
+        for (int c = target.firstChild; c < target.firstChild + target.childCount; ++c) {
+            Interact(c, sourceIndex);
+        }
+    }
+    else {
+        for (int c = source.firstChild; c < source.firstChild + source.childCount; ++c) {
+            Interact(targetIndex, c);
+        }
+    }
+}
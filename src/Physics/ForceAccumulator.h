@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "Parallel.h"
+#include "Particles.h"
+
+// Per task force buffers for the half pair kernels. A pair (i, j) adds to both i and j, so two
+// tasks may touch the same particle; each task therefore writes only to its own buffer and End()
+// sums the buffers in task order. Tasks are split the same way whichever thread ends up running
+// them, so the result is the same on every run for a given thread count. With a single task the
+// kernel writes straight into the output.
+class ForceAccumulator {
+public:
+    void Begin(Vec3Array& forces, int particleCount, int taskCount) {
+        m_Output = &forces;
+        m_ParticleCount = particleCount;
+        m_TaskCount = std::max(1, taskCount);
+
+        forces.Assign(particleCount);
+
+        if (m_TaskCount == 1) return;
+
+        m_Buffers.resize(m_TaskCount);
+        for (auto& buffer : m_Buffers) {
+            buffer.Assign(particleCount);
+        }
+    }
+
+    Vec3Array& Buffer(int task) {
+        return m_TaskCount == 1 ? *m_Output : m_Buffers[task];
+    }
+
+    void End(ThreadPool& pool) {
+        if (m_TaskCount == 1) return;
+
+        ParallelFor(pool, m_ParticleCount, [&](int begin, int end, int) {
+            Vec3Array& output = *m_Output;
+
+            for (int t = 0; t < m_TaskCount; ++t) {
+                const Vec3Array& buffer = m_Buffers[t];
+
+                for (int i = begin; i < end; ++i) {
+                    output.x[i] += buffer.x[i];
+                    output.y[i] += buffer.y[i];
+                    output.z[i] += buffer.z[i];
+                }
+            }
+        });
+    }
+
+private:
+    Vec3Array* m_Output{ nullptr };
+    int m_ParticleCount{ 0 };
+    int m_TaskCount{ 1 };
+
+    std::vector<Vec3Array> m_Buffers;
+};
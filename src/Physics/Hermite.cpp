@@ -0,0 +1,172 @@
+#include "Hermite.h"
+
+#include <algorithm>
+
+#include "Parallel.h"
+
+namespace {
+    void CopyPositions(const Particles& particles, Vec3Array& positions, Vec3Array& velocities) {
+        positions.x.assign(particles.x.begin(), particles.x.end());
+        positions.y.assign(particles.y.begin(), particles.y.end());
+        positions.z.assign(particles.z.begin(), particles.z.end());
+
+        velocities.x.assign(particles.vx.begin(), particles.vx.end());
+        velocities.y.assign(particles.vy.begin(), particles.vy.end());
+        velocities.z.assign(particles.vz.begin(), particles.vz.end());
+    }
+}
+
+void HermiteIntegrator::Evaluate(const Particles& particles, const Vec3Array& positions, const Vec3Array& velocities, ThreadPool& pool, Vec3Array& acceleration, Vec3Array& jerk) {
+    const int count = particles.Size();
+    const int chargedEnd = particles.ChargedEnd();
+    const int nucleonBegin = particles.NucleonBegin();
+
+    acceleration.Assign(count);
+    jerk.Assign(count);
+
+    // Full rows rather than half pairs, so every particle is written by a single task
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            const glm::vec3 position = positions.Get(i);
+            const glm::vec3 velocity = velocities.Get(i);
+
+            glm::vec3 force{ 0.0f };
+            glm::vec3 forceRate{ 0.0f };
+
+            // A central pair force g(r) * d changes at g(r) * v + g'(r) * (d . v / r) * d
+            auto addPair = [&](float g, float gDerivative, const glm::vec3& offset, const glm::vec3& relativeVelocity, float distance) {
+                force += g * offset;
+                forceRate += g * relativeVelocity + (gDerivative * glm::dot(offset, relativeVelocity) / distance) * offset;
+            };
+
+            if (i < chargedEnd) {
+                for (int j = 0; j < chargedEnd; ++j) {
+                    if (j == i) continue;
+
+                    glm::vec3 offset = position - positions.Get(j);
+                    glm::vec3 relativeVelocity = velocity - velocities.Get(j);
+
+                    float distance = glm::length(offset);
+                    float inverseDistance = 1.0f / distance;
+                    float inverseDistance3 = inverseDistance * inverseDistance * inverseDistance;
+
+                    // q1 * q2 / r^2, so g(r) = q1 * q2 / r^3
+                    float chargeProduct = particles.charge[i] * particles.charge[j];
+
+                    addPair(chargeProduct * inverseDistance3, -3.0f * chargeProduct * inverseDistance3 * inverseDistance, offset, relativeVelocity, distance);
+                }
+            }
+
+            if (i >= nucleonBegin) {
+                for (int j = nucleonBegin; j < count; ++j) {
+                    if (j == i) continue;
+
+                    glm::vec3 offset = position - positions.Get(j);
+                    glm::vec3 relativeVelocity = velocity - velocities.Get(j);
+
+                    float distance = glm::length(offset);
+                    float inverseDistance = 1.0f / distance;
+                    float inverseDistance2 = inverseDistance * inverseDistance;
+                    float inverseDistance3 = inverseDistance2 * inverseDistance;
+                    float inverseDistance11 = inverseDistance3 * inverseDistance3 * inverseDistance3 * inverseDistance2;
+
+                    // Same force as the nuclear pair kernels, F(r) = 1 / r^10 - (e^r / r^2 + e^r / r),
+                    // so g(r) = F(r) / r = 1 / r^11 - e^r * (1 / r^3 + 1 / r^2)
+                    float exponential = glm::exp(distance);
+
+                    float g = inverseDistance11 - exponential * (inverseDistance3 + inverseDistance2);
+                    float gDerivative = -11.0f * inverseDistance11 * inverseDistance - exponential * (inverseDistance2 - inverseDistance3 - 3.0f * inverseDistance3 * inverseDistance);
+
+                    addPair(g, gDerivative, offset, relativeVelocity, distance);
+                }
+            }
+
+            const float inverseMass = particles.inverseMass[i];
+
+            acceleration.Set(i, force * inverseMass);
+            jerk.Set(i, forceRate * inverseMass);
+        }
+    });
+}
+
+float HermiteIntegrator::SubstepLength(const Particles& particles, float remaining, float dt) const {
+    if (accuracy <= 0.0f) return remaining;
+
+    float timeScale = remaining / accuracy;
+
+    for (int i = 0; i < particles.Size(); ++i) {
+        float jerkMagnitude = glm::length(m_Jerk.Get(i));
+
+        if (jerkMagnitude > 0.0f) {
+            timeScale = std::min(timeScale, glm::length(m_Acceleration.Get(i)) / jerkMagnitude);
+        }
+    }
+
+    const float minimum = dt / (float)std::max(1, maxSubsteps);
+
+    return std::min(remaining, std::max(accuracy * timeScale, minimum));
+}
+
+void HermiteIntegrator::Step(Particles& particles, float dt, ThreadPool& pool) {
+    const int count = particles.Size();
+
+    if (!m_Valid || m_Acceleration.Size() != count) {
+        CopyPositions(particles, m_PredictedPositions, m_PredictedVelocities);
+        Evaluate(particles, m_PredictedPositions, m_PredictedVelocities, pool, m_Acceleration, m_Jerk);
+        m_Valid = true;
+    }
+
+    m_PredictedPositions.Assign(count);
+    m_PredictedVelocities.Assign(count);
+
+    m_SubstepCount = 0;
+
+    float remaining = dt;
+
+    while (remaining > 0.0f) {
+        const float h = SubstepLength(particles, remaining, dt);
+        const float h2 = h * h;
+
+        ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+            for (int i = rangeBegin; i < rangeEnd; ++i) {
+                glm::vec3 position = particles.Position(i);
+                glm::vec3 velocity = particles.Velocity(i);
+                glm::vec3 acceleration = m_Acceleration.Get(i);
+                glm::vec3 jerk = m_Jerk.Get(i);
+
+                m_PredictedPositions.Set(i, position + velocity * h + acceleration * (h2 / 2.0f) + jerk * (h2 * h / 6.0f));
+                m_PredictedVelocities.Set(i, velocity + acceleration * h + jerk * (h2 / 2.0f));
+            }
+        });
+
+        Evaluate(particles, m_PredictedPositions, m_PredictedVelocities, pool, m_NewAcceleration, m_NewJerk);
+
+        ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+            for (int i = rangeBegin; i < rangeEnd; ++i) {
+                glm::vec3 velocity = particles.Velocity(i);
+                glm::vec3 acceleration = m_Acceleration.Get(i);
+                glm::vec3 newAcceleration = m_NewAcceleration.Get(i);
+
+                glm::vec3 newVelocity = velocity + (acceleration + newAcceleration) * (h / 2.0f) + (m_Jerk.Get(i) - m_NewJerk.Get(i)) * (h2 / 12.0f);
+                glm::vec3 newPosition = particles.Position(i) + (velocity + newVelocity) * (h / 2.0f) + (acceleration - newAcceleration) * (h2 / 12.0f);
+
+                particles.x[i] = newPosition.x;
+                particles.y[i] = newPosition.y;
+                particles.z[i] = newPosition.z;
+
+                particles.vx[i] = newVelocity.x;
+                particles.vy[i] = newVelocity.y;
+                particles.vz[i] = newVelocity.z;
+            }
+        });
+
+        // The corrected state is close enough to the predicted one that its forces carry over
+        std::swap(m_Acceleration, m_NewAcceleration);
+        std::swap(m_Jerk, m_NewJerk);
+
+        remaining -= h;
+        ++m_SubstepCount;
+
+        if (remaining < dt * 1e-6f) break;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Fourth order Hermite predictor-corrector (Makino and Aarseth 1992). Besides the acceleration of
+// every particle the pair sums also give its time derivative, the jerk, which lets a step be
+// predicted to third order and corrected to fourth order from a single force evaluation:
+//
+//   predict  x_p = x + v dt + a dt^2 / 2 + j dt^3 / 6,  v_p = v + a dt + j dt^2 / 2
+//   evaluate a_1, j_1 at x_p, v_p
+//   correct  v_1 = v + (a + a_1) dt / 2 + (j - j_1) dt^2 / 12
+//            x_1 = x + (v + v_1) dt / 2 + (a - a_1) dt^2 / 12
+//
+// The energy error falls with dt^4 rather than dt^2, so close electron orbits stay bound with far
+// larger steps than velocity Verlet needs. Forces are always the direct Coulomb and nuclear sums
+// without a cutoff, in an open box.
+class HermiteIntegrator {
+public:
+    // Each Step is split into substeps of accuracy * min |a| / |jerk| over all particles, so the
+    // step shrinks during close encounters. 0 always takes the whole step at once.
+    float accuracy{ 0.05f };
+
+    // Substeps never get shorter than the step divided by this
+    int maxSubsteps{ 1024 };
+
+    void Step(Particles& particles, float dt, ThreadPool& pool);
+
+    // Accelerations and jerks are recomputed on the next Step, for when the particles change
+    void Invalidate() { m_Valid = false; }
+
+    // Force evaluations made by the last Step
+    int GetSubstepCount() const { return m_SubstepCount; }
+
+private:
+    // Acceleration and jerk of every particle at the given positions and velocities
+    void Evaluate(const Particles& particles, const Vec3Array& positions, const Vec3Array& velocities, ThreadPool& pool, Vec3Array& acceleration, Vec3Array& jerk);
+
+    float SubstepLength(const Particles& particles, float remaining, float dt) const;
+
+    Vec3Array m_Acceleration;
+    Vec3Array m_Jerk;
+
+    Vec3Array m_PredictedPositions;
+    Vec3Array m_PredictedVelocities;
+
+    Vec3Array m_NewAcceleration;
+    Vec3Array m_NewJerk;
+
+    bool m_Valid{ false };
+    int m_SubstepCount{ 0 };
+};
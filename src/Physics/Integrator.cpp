@@ -0,0 +1,63 @@
+#include "Integrator.h"
+
+#include "Coulomb.h"
+#include "Nuclear.h"
+#include "Parallel.h"
+#include "Periodic.h"
+#include "Profiler.h"
+
+void Kick(Particles& particles, int begin, int end, const Vec3Array& forces, float dt, ThreadPool& pool) {
+    ParallelFor(pool, end - begin, [&](int rangeBegin, int rangeEnd, int) {
+        for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+            float scale = particles.inverseMass[i] * dt;
+
+            particles.vx[i] += forces.x[i] * scale;
+            particles.vy[i] += forces.y[i] * scale;
+            particles.vz[i] += forces.z[i] * scale;
+        }
+    });
+}
+
+void Drift(Particles& particles, int begin, int end, float dt, bool periodic, float boxSize, ThreadPool& pool) {
+    ParallelFor(pool, end - begin, [&](int rangeBegin, int rangeEnd, int) {
+        for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+            particles.x[i] += particles.vx[i] * dt;
+            particles.y[i] += particles.vy[i] * dt;
+            particles.z[i] += particles.vz[i] * dt;
+        }
+
+        if (periodic) {
+            for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+                glm::vec3 position = WrapPosition(particles.Position(i), boxSize);
+
+                particles.x[i] = position.x;
+                particles.y[i] = position.y;
+                particles.z[i] = position.z;
+            }
+        }
+    });
+}
+
+void SumForces(const Vec3Array& coulombForces, const Vec3Array& nuclearForces, int count, Vec3Array& forces) {
+    forces.Assign(count);
+
+    for (int i = 0; i < count; ++i) {
+        forces.x[i] = coulombForces.x[i] + nuclearForces.x[i];
+        forces.y[i] = coulombForces.y[i] + nuclearForces.y[i];
+        forces.z[i] = coulombForces.z[i] + nuclearForces.z[i];
+    }
+}
+
+void DirectForces(const Particles& particles, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& coulombForces, Vec3Array& nuclearForces, Vec3Array& forces) {
+    {
+        ProfileScope profileScope{ "Coulomb" };
+        DirectCoulombForces(particles, 0, particles.ChargedEnd(), accumulator, pool, simdLevel, coulombForces);
+    }
+
+    {
+        ProfileScope profileScope{ "Nuclear" };
+        NuclearForces(particles, particles.NucleonBegin(), particles.Size(), false, 0.0f, accumulator, pool, simdLevel, nuclearForces);
+    }
+
+    SumForces(coulombForces, nuclearForces, particles.Size(), forces);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "ForceAccumulator.h"
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Building blocks of the symplectic integrators. One velocity Verlet (kick-drift-kick leapfrog)
+// step of length dt is Kick(dt / 2), Drift(dt), a force evaluation at the new positions, then
+// Kick(dt / 2). The forces at the end of a step are the ones the next step starts with, so each
+// step costs a single force evaluation.
+//
+// r-RESPA splits one step of length dt into innerSteps velocity Verlet steps that only feel the
+// fast nuclear force, wrapped in half kicks from the slow Coulomb force: Kick(slow, dt / 2), the
+// inner steps, a Coulomb evaluation, then Kick(slow, dt / 2). The Coulomb sum is evaluated once per
+// dt while the stiff nuclear core is still integrated with dt / innerSteps.
+
+enum class IntegrationScheme {
+    VelocityVerlet,
+    BlockTimesteps,
+    Respa,
+    Hermite
+};
+
+// v += F / m * dt for every particle in [begin, end)
+void Kick(Particles& particles, int begin, int end, const Vec3Array& forces, float dt, ThreadPool& pool);
+
+// x += v * dt for every particle in [begin, end), wrapped back into the box when periodic
+void Drift(Particles& particles, int begin, int end, float dt, bool periodic, float boxSize, ThreadPool& pool);
+
+// forces = coulombForces + nuclearForces for the first count particles
+void SumForces(const Vec3Array& coulombForces, const Vec3Array& nuclearForces, int count, Vec3Array& forces);
+
+// Total force on every particle in an open box from the direct sums: DirectCoulombForces over the
+// charged particles plus NuclearForces over the nucleons. The two parts are left in coulombForces
+// and nuclearForces for the integrators that kick with them separately.
+void DirectForces(const Particles& particles, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& coulombForces, Vec3Array& nuclearForces, Vec3Array& forces);
@@ -0,0 +1,290 @@
+#include "KSRegularization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Arena.h"
+#include "Integrator.h"
+#include "Parallel.h"
+
+namespace {
+    struct KeplerState {
+        double position[3];
+        double velocity[3];
+    };
+
+    // Advances relative motion under r'' = -mu r / r^3 by dt through the KS transformation
+    KeplerState KeplerDrift(const KeplerState& start, double mu, double dt) {
+        const double x = start.position[0];
+        const double y = start.position[1];
+        const double z = start.position[2];
+        const double vx = start.velocity[0];
+        const double vy = start.velocity[1];
+        const double vz = start.velocity[2];
+
+        const double r = std::sqrt(x * x + y * y + z * z);
+
+        // Any u with KS(u) = x will do, pick the branch that avoids dividing by a small number
+        double u[4];
+        if (x >= 0.0) {
+            u[0] = std::sqrt(0.5 * (r + x));
+            u[3] = 0.0;
+            u[1] = u[0] > 0.0 ? y / (2.0 * u[0]) : 0.0;
+            u[2] = u[0] > 0.0 ? z / (2.0 * u[0]) : 0.0;
+        }
+        else {
+            u[1] = std::sqrt(0.5 * (r - x));
+            u[2] = 0.0;
+            u[0] = y / (2.0 * u[1]);
+            u[3] = z / (2.0 * u[1]);
+        }
+
+        // du/ds = L(u)^T v / 2
+        double w[4] = {
+            0.5 * ( u[0] * vx + u[1] * vy + u[2] * vz),
+            0.5 * (-u[1] * vx + u[0] * vy + u[3] * vz),
+            0.5 * (-u[2] * vx - u[3] * vy + u[0] * vz),
+            0.5 * ( u[3] * vx - u[2] * vy + u[1] * vz)
+        };
+
+        // In fictitious time the Kepler problem is u'' = (h / 2) u, h the energy per unit reduced mass
+        const double h = 0.5 * (vx * vx + vy * vy + vz * vz) - mu / r;
+        const double omega = std::sqrt(std::abs(0.5 * h));
+        const bool bound = h < 0.0;
+
+        const double a = u[0] * u[0] + u[1] * u[1] + u[2] * u[2] + u[3] * u[3];
+        const double b = u[0] * w[0] + u[1] * w[1] + u[2] * w[2] + u[3] * w[3];
+        const double c = w[0] * w[0] + w[1] * w[1] + w[2] * w[2] + w[3] * w[3];
+
+        // u(s) = u cos(omega s) + w / omega sin(omega s), or cosh and sinh when unbound
+        auto basis = [&](double s, double& cs, double& sn) {
+            if (omega * s < 1e-8) {
+                cs = 1.0;
+                sn = s;
+            }
+            else if (bound) {
+                cs = std::cos(omega * s);
+                sn = std::sin(omega * s) / omega;
+            }
+            else {
+                cs = std::cosh(omega * s);
+                sn = std::sinh(omega * s) / omega;
+            }
+        };
+
+        // t(s) is the integral of |u(s)|^2 = r(s)
+        auto time = [&](double s) {
+            double cs, sn;
+            basis(s, cs, sn);
+
+            const double sign = bound ? 1.0 : -1.0;
+
+            // Integrals of cos^2, sin cos and sin^2 (sinh and cosh when unbound), sin scaled by 1 / omega
+            // The closed form cancels badly for small omega * s, use the series there
+            const double phase2 = omega * omega * s * s;
+            const double integralSn2 = phase2 < 1e-6 ? s * s * s * (1.0 / 3.0 - sign * phase2 / 15.0) : sign * (s - cs * sn) / (2.0 * omega * omega);
+            const double integralCs2 = 0.5 * (s + cs * sn);
+            const double integralCsSn = 0.5 * sn * sn;
+
+            return a * integralCs2 + 2.0 * b * integralCsSn + c * integralSn2;
+        };
+
+        // Newton on t(s) = dt, falling back to bisection, t grows monotonically since dt/ds = r >= 0
+        double low = 0.0;
+        double high = dt / std::max(r, 1e-12);
+        while (time(high) < dt) {
+            low = high;
+            high *= 2.0;
+        }
+
+        double s = 0.5 * (low + high);
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            const double error = time(s) - dt;
+
+            if (error > 0.0) high = s;
+            else low = s;
+
+            double cs, sn;
+            basis(s, cs, sn);
+
+            const double rate = a * cs * cs + 2.0 * b * cs * sn + c * sn * sn;
+
+            double next = rate > 0.0 ? s - error / rate : 0.5 * (low + high);
+            if (!(next > low && next < high)) next = 0.5 * (low + high);
+
+            if (std::abs(next - s) <= 1e-15 * s) {
+                s = next;
+                break;
+            }
+
+            s = next;
+        }
+
+        double cs, sn;
+        basis(s, cs, sn);
+
+        // w(s) = u'(s) = -omega^2 u sin + w cos, +omega^2 when unbound
+        const double sign = bound ? -1.0 : 1.0;
+
+        double uNew[4];
+        double wNew[4];
+        for (int k = 0; k < 4; ++k) {
+            uNew[k] = u[k] * cs + w[k] * sn;
+            wNew[k] = sign * omega * omega * u[k] * sn + w[k] * cs;
+        }
+
+        const double rNew = uNew[0] * uNew[0] + uNew[1] * uNew[1] + uNew[2] * uNew[2] + uNew[3] * uNew[3];
+
+        KeplerState end{ };
+
+        end.position[0] = uNew[0] * uNew[0] - uNew[1] * uNew[1] - uNew[2] * uNew[2] + uNew[3] * uNew[3];
+        end.position[1] = 2.0 * (uNew[0] * uNew[1] - uNew[2] * uNew[3]);
+        end.position[2] = 2.0 * (uNew[0] * uNew[2] + uNew[1] * uNew[3]);
+
+        // v = 2 L(u) u' / r
+        const double scale = rNew > 0.0 ? 2.0 / rNew : 0.0;
+
+        end.velocity[0] = scale * (uNew[0] * wNew[0] - uNew[1] * wNew[1] - uNew[2] * wNew[2] + uNew[3] * wNew[3]);
+        end.velocity[1] = scale * (uNew[1] * wNew[0] + uNew[0] * wNew[1] - uNew[3] * wNew[2] - uNew[2] * wNew[3]);
+        end.velocity[2] = scale * (uNew[2] * wNew[0] + uNew[3] * wNew[1] + uNew[0] * wNew[2] + uNew[1] * wNew[3]);
+
+        return end;
+    }
+}
+
+void KSRegularization::FindPairs(const Particles& particles, ThreadPool& pool) {
+    const int electronCount = particles.Count(Species::Electron);
+    const int protonBegin = electronCount;
+    const int protonEnd = particles.ChargedEnd();
+
+    m_NearestProton.assign(electronCount, -1);
+    m_NearestDistance.assign(electronCount, 0.0f);
+
+    ParallelFor(pool, electronCount, [&](int rangeBegin, int rangeEnd, int) {
+        for (int e = rangeBegin; e < rangeEnd; ++e) {
+            float nearest = distance * distance;
+
+            for (int p = protonBegin; p < protonEnd; ++p) {
+                float dx = particles.x[e] - particles.x[p];
+                float dy = particles.y[e] - particles.y[p];
+                float dz = particles.z[e] - particles.z[p];
+
+                float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+                if (distanceSquared < nearest) {
+                    nearest = distanceSquared;
+                    m_NearestProton[e] = p;
+                    m_NearestDistance[e] = distanceSquared;
+                }
+            }
+        }
+    });
+
+    m_Pairs.clear();
+
+    for (int e = 0; e < electronCount; ++e) {
+        if (m_NearestProton[e] >= 0) m_Pairs.push_back(Pair{ e, m_NearestProton[e] });
+    }
+
+    // Closest pairs first, a proton already taken leaves its other electrons unpaired
+    std::sort(m_Pairs.begin(), m_Pairs.end(), [&](const Pair& left, const Pair& right) {
+        return m_NearestDistance[left.electron] < m_NearestDistance[right.electron];
+    });
+
+    ScratchScope scratch{ };
+
+    bool* taken = scratch.Allocate<bool>(protonEnd - protonBegin);
+    std::fill(taken, taken + (protonEnd - protonBegin), false);
+
+    auto last = std::remove_if(m_Pairs.begin(), m_Pairs.end(), [&](const Pair& pair) {
+        if (taken[pair.proton - protonBegin]) return true;
+
+        taken[pair.proton - protonBegin] = true;
+        return false;
+    });
+
+    m_Pairs.erase(last, m_Pairs.end());
+}
+
+const Vec3Array& KSRegularization::ExternalForces(const Particles& particles, const Vec3Array& forces) {
+    m_ExternalForces = forces;
+
+    for (const Pair& pair : m_Pairs) {
+        const int e = pair.electron;
+        const int p = pair.proton;
+
+        glm::vec3 offset = particles.Position(e) - particles.Position(p);
+
+        float inverseDistance = 1.0f / glm::length(offset);
+        glm::vec3 force = (particles.charge[e] * particles.charge[p] * inverseDistance * inverseDistance * inverseDistance) * offset;
+
+        m_ExternalForces.Set(e, m_ExternalForces.Get(e) - force);
+        m_ExternalForces.Set(p, m_ExternalForces.Get(p) + force);
+    }
+
+    return m_ExternalForces;
+}
+
+void KSRegularization::Drift(Particles& particles, float dt, ThreadPool& pool) {
+    m_PairStates.resize(4 * m_Pairs.size());
+
+    ParallelFor(pool, (int)m_Pairs.size(), [&](int rangeBegin, int rangeEnd, int) {
+        for (int n = rangeBegin; n < rangeEnd; ++n) {
+            const int e = m_Pairs[n].electron;
+            const int p = m_Pairs[n].proton;
+
+            const double massE = particles.mass[e];
+            const double massP = particles.mass[p];
+            const double totalMass = massE + massP;
+
+            // The centre of mass moves in a straight line, the offset follows the Kepler orbit.
+            // Kept in double until the end, float rounding here would pump energy into the orbit
+            KeplerState start{ };
+            double centre[3];
+            double centreVelocity[3];
+
+            const float* positions[3] = { particles.x.data(), particles.y.data(), particles.z.data() };
+            const float* velocities[3] = { particles.vx.data(), particles.vy.data(), particles.vz.data() };
+
+            for (int k = 0; k < 3; ++k) {
+                centre[k] = (positions[k][e] * massE + positions[k][p] * massP) / totalMass;
+                centreVelocity[k] = (velocities[k][e] * massE + velocities[k][p] * massP) / totalMass;
+
+                start.position[k] = (double)positions[k][e] - positions[k][p];
+                start.velocity[k] = (double)velocities[k][e] - velocities[k][p];
+            }
+
+            const double mu = -(double)particles.charge[e] * particles.charge[p] * (1.0 / massE + 1.0 / massP);
+
+            KeplerState end = KeplerDrift(start, mu, dt);
+
+            for (int k = 0; k < 3; ++k) {
+                const double newCentre = centre[k] + centreVelocity[k] * dt;
+
+                m_PairStates[4 * n + 0][k] = (float)(newCentre + end.position[k] * massP / totalMass);
+                m_PairStates[4 * n + 1][k] = (float)(centreVelocity[k] + end.velocity[k] * massP / totalMass);
+                m_PairStates[4 * n + 2][k] = (float)(newCentre - end.position[k] * massE / totalMass);
+                m_PairStates[4 * n + 3][k] = (float)(centreVelocity[k] - end.velocity[k] * massE / totalMass);
+            }
+        }
+    });
+
+    ::Drift(particles, 0, particles.Size(), dt, false, 0.0f, pool);
+
+    for (int n = 0; n < (int)m_Pairs.size(); ++n) {
+        const int members[2] = { m_Pairs[n].electron, m_Pairs[n].proton };
+
+        for (int k = 0; k < 2; ++k) {
+            const glm::vec3& position = m_PairStates[4 * n + 2 * k];
+            const glm::vec3& velocity = m_PairStates[4 * n + 2 * k + 1];
+
+            particles.x[members[k]] = position.x;
+            particles.y[members[k]] = position.y;
+            particles.z[members[k]] = position.z;
+
+            particles.vx[members[k]] = velocity.x;
+            particles.vy[members[k]] = velocity.y;
+            particles.vz[members[k]] = velocity.z;
+        }
+    }
+}
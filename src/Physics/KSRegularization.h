@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Kustaanheimo-Stiefel regularization of close electron-proton encounters for the velocity Verlet
+// integrator. Every step each electron closer than distance to a proton is paired with its nearest
+// free proton, and the pair's mutual attraction is taken out of the kicks. Instead the pair drifts
+// along its exact two-body Kepler orbit, while every other force still reaches it through the
+// kicks, the same splitting mixed variable symplectic integrators use for planets.
+//
+// The Kepler drift is solved in KS coordinates, where the relative motion of the pair becomes a
+// four dimensional harmonic oscillator in the fictitious time s with dt = r ds. The oscillator is
+// solved in closed form, so the drift stays exact however close the electron passes, even through
+// a head on collision, and the rest of the atom keeps its step.
+class KSRegularization {
+public:
+    float distance{ 0.5f };
+
+    // Pairs up the electrons and protons closer than distance, call at the start of each step
+    void FindPairs(const Particles& particles, ThreadPool& pool);
+
+    // forces without the attraction within each pair, valid until the next call
+    const Vec3Array& ExternalForces(const Particles& particles, const Vec3Array& forces);
+
+    // Drift like ::Drift in an open box, except that the pairs follow their Kepler orbits
+    void Drift(Particles& particles, float dt, ThreadPool& pool);
+
+    int GetPairCount() const { return (int)m_Pairs.size(); }
+
+private:
+    struct Pair {
+        int electron;
+        int proton;
+    };
+
+    std::vector<Pair> m_Pairs;
+    std::vector<int> m_NearestProton;
+    std::vector<float> m_NearestDistance;
+
+    Vec3Array m_ExternalForces;
+
+    // Positions and velocities of the pair members after the drift, electron then proton
+    std::vector<glm::vec3> m_PairStates;
+};
@@ -0,0 +1,316 @@
+#include "Nuclear.h"
+
+#include <algorithm>
+
+#include "Arena.h"
+#include "PairKernels.h"
+#include "Parallel.h"
+#include "Periodic.h"
+
+void NuclearForces(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    accumulator.Begin(forces, particles.Size(), ParallelTaskCount(pool, end - begin));
+
+    const PairRowKernel kernel = GetNuclearRowKernel(simdLevel);
+
+    ParallelForPairs(pool, end - begin, [&](int rangeBegin, int rangeEnd, int task) {
+        Vec3Array& buffer = accumulator.Buffer(task);
+
+        PairRow row{ };
+        row.x = particles.x.data();
+        row.y = particles.y.data();
+        row.z = particles.z.data();
+        row.charge = particles.charge.data();
+        row.fx = buffer.x.data();
+        row.fy = buffer.y.data();
+        row.fz = buffer.z.data();
+        row.jEnd = end;
+        row.periodic = periodic;
+        row.boxSize = boxSize;
+        row.inverseBoxSize = periodic ? 1.0f / boxSize : 0.0f;
+
+        for (int i = begin + rangeBegin; i < begin + rangeEnd; ++i) {
+            row.i = i;
+            row.jBegin = i + 1;
+
+            glm::vec3 force = kernel(row);
+
+            buffer.x[i] += force.x;
+            buffer.y[i] += force.y;
+            buffer.z[i] += force.z;
+        }
+    });
+
+    accumulator.End(pool);
+}
+
+void NuclearForcesOn(const Particles& particles, int begin, int end, const int* targets, int targetCount, bool periodic, float boxSize, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    if (forces.Size() != particles.Size()) forces.Assign(particles.Size());
+
+    const PairRowKernel kernel = GetNuclearRowKernel(simdLevel);
+
+    ParallelFor(pool, targetCount, [&](int rangeBegin, int rangeEnd, int) {
+        PairRow row{ };
+        row.x = particles.x.data();
+        row.y = particles.y.data();
+        row.z = particles.z.data();
+        row.charge = particles.charge.data();
+        row.periodic = periodic;
+        row.boxSize = boxSize;
+        row.inverseBoxSize = periodic ? 1.0f / boxSize : 0.0f;
+
+        for (int t = rangeBegin; t < rangeEnd; ++t) {
+            const int i = targets[t];
+
+            row.i = i;
+            row.jBegin = begin;
+            row.jEnd = i;
+
+            glm::vec3 force = kernel(row);
+
+            row.jBegin = i + 1;
+            row.jEnd = end;
+
+            force += kernel(row);
+
+            forces.Set(i, force);
+        }
+    });
+}
+
+void NuclearCellList::Evaluate(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    m_Cells.Build(particles, begin, end, std::max(cellSize, cutoff), periodic, boxSize);
+
+    const int cellCount = m_Cells.GetCellCount();
+    const Vec3Array& positions = m_Cells.GetPositions();
+
+    accumulator.Begin(m_SortedForces, positions.Size(), ParallelTaskCount(pool, cellCount));
+
+    const PairRowKernel kernel = GetNuclearRowKernel(simdLevel);
+
+    ParallelFor(pool, cellCount, [&](int cellBegin, int cellEnd, int task) {
+        Vec3Array& buffer = accumulator.Buffer(task);
+
+        PairRow row{ };
+        row.x = positions.x.data();
+        row.y = positions.y.data();
+        row.z = positions.z.data();
+        row.charge = m_Cells.GetCharges().data();
+        row.fx = buffer.x.data();
+        row.fy = buffer.y.data();
+        row.fz = buffer.z.data();
+        row.periodic = periodic;
+        row.boxSize = boxSize;
+        row.inverseBoxSize = periodic ? 1.0f / boxSize : 0.0f;
+        row.cutoff = cutoff;
+        row.inverseSwitchWidth = 1.0f / std::min(1.0f, 0.5f * cutoff);
+
+        std::array<int, 13> neighbours;
+
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            const int neighbourCount = m_Cells.ForwardNeighbours(cell, neighbours);
+
+            for (int i = m_Cells.CellBegin(cell); i < m_Cells.CellEnd(cell); ++i) {
+                row.i = i;
+                row.jBegin = i + 1;
+                row.jEnd = m_Cells.CellEnd(cell);
+
+                glm::vec3 force = kernel(row);
+
+                for (int n = 0; n < neighbourCount; ++n) {
+                    row.jBegin = m_Cells.CellBegin(neighbours[n]);
+                    row.jEnd = m_Cells.CellEnd(neighbours[n]);
+
+                    force += kernel(row);
+                }
+
+                buffer.x[i] += force.x;
+                buffer.y[i] += force.y;
+                buffer.z[i] += force.z;
+            }
+        }
+    });
+
+    accumulator.End(pool);
+
+    forces.Assign(particles.Size());
+
+    const std::vector<int>& order = m_Cells.GetOrder();
+
+    ParallelFor(pool, (int)order.size(), [&](int rangeBegin, int rangeEnd, int) {
+        for (int sorted = rangeBegin; sorted < rangeEnd; ++sorted) {
+            forces.x[order[sorted]] = m_SortedForces.x[sorted];
+            forces.y[order[sorted]] = m_SortedForces.y[sorted];
+            forces.z[order[sorted]] = m_SortedForces.z[sorted];
+        }
+    });
+}
+
+void NuclearNeighbourList::Evaluate(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces) {
+    const bool sameSetup = m_Valid && begin == m_Begin && end == m_End && periodic == m_Periodic && boxSize == m_BoxSize && cutoff == m_BuildCutoff && skin == m_BuildSkin;
+
+    m_Begin = begin;
+    m_End = end;
+    m_Periodic = periodic;
+    m_BoxSize = boxSize;
+
+    if (!sameSetup || Moved(particles, pool)) {
+        Build(particles, begin, end, pool);
+    }
+
+    ++m_StepCount;
+
+    const int count = (int)m_Order.size();
+
+    accumulator.Begin(m_SortedForces, count, ParallelTaskCount(pool, count));
+
+    const PairRowKernel kernel = GetNuclearListKernel(simdLevel);
+
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int task) {
+        Vec3Array& buffer = accumulator.Buffer(task);
+
+        PairRow row{ };
+        row.x = m_Positions.x.data();
+        row.y = m_Positions.y.data();
+        row.z = m_Positions.z.data();
+        row.charge = m_Charges.data();
+        row.fx = buffer.x.data();
+        row.fy = buffer.y.data();
+        row.fz = buffer.z.data();
+        row.neighbours = m_Neighbours.data();
+        row.periodic = periodic;
+        row.boxSize = boxSize;
+        row.inverseBoxSize = periodic ? 1.0f / boxSize : 0.0f;
+        row.cutoff = cutoff;
+        row.inverseSwitchWidth = 1.0f / std::min(1.0f, 0.5f * cutoff);
+
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            row.i = i;
+            row.jBegin = m_ListStarts[i];
+            row.jEnd = m_ListStarts[i + 1];
+
+            glm::vec3 force = kernel(row);
+
+            buffer.x[i] += force.x;
+            buffer.y[i] += force.y;
+            buffer.z[i] += force.z;
+        }
+    });
+
+    accumulator.End(pool);
+
+    forces.Assign(particles.Size());
+
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+        for (int sorted = rangeBegin; sorted < rangeEnd; ++sorted) {
+            forces.x[m_Order[sorted]] = m_SortedForces.x[sorted];
+            forces.y[m_Order[sorted]] = m_SortedForces.y[sorted];
+            forces.z[m_Order[sorted]] = m_SortedForces.z[sorted];
+        }
+    });
+}
+
+bool NuclearNeighbourList::Moved(const Particles& particles, ThreadPool& pool) {
+    const int count = (int)m_Order.size();
+    const float limit = 0.5f * skin;
+
+    m_TaskDisplacements.assign(ParallelTaskCount(pool, count), 0.0f);
+
+    // Gather the current positions into list order and track the largest move since the build
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int task) {
+        float largest = 0.0f;
+
+        for (int sorted = rangeBegin; sorted < rangeEnd; ++sorted) {
+            const glm::vec3 position = particles.Position(m_Order[sorted]);
+
+            m_Positions.Set(sorted, position);
+
+            glm::vec3 offset = position - m_BuildPositions.Get(sorted);
+            if (m_Periodic) offset = MinimumImage(offset, m_BoxSize);
+
+            largest = std::max(largest, glm::dot(offset, offset));
+        }
+
+        m_TaskDisplacements[task] = largest;
+    });
+
+    return *std::max_element(m_TaskDisplacements.begin(), m_TaskDisplacements.end()) > limit * limit;
+}
+
+void NuclearNeighbourList::Build(const Particles& particles, int begin, int end, ThreadPool& pool) {
+    const float radius = cutoff + skin;
+    const float radiusSquared = radius * radius;
+
+    m_Cells.Build(particles, begin, end, radius, m_Periodic, m_BoxSize);
+
+    m_Order = m_Cells.GetOrder();
+    m_Positions = m_Cells.GetPositions();
+    m_BuildPositions = m_Positions;
+    m_Charges = m_Cells.GetCharges();
+
+    const int count = (int)m_Order.size();
+    const int cellCount = m_Cells.GetCellCount();
+
+    // Calls visit(i, j) for every pair within the list radius with i in the cell, each pair once
+    auto forEachPair = [&](int cell, auto&& visit) {
+        std::array<int, 13> neighbours;
+        const int neighbourCount = m_Cells.ForwardNeighbours(cell, neighbours);
+
+        auto test = [&](int i, int j) {
+            glm::vec3 offset = m_Positions.Get(i) - m_Positions.Get(j);
+            if (m_Periodic) offset = MinimumImage(offset, m_BoxSize);
+
+            if (glm::dot(offset, offset) < radiusSquared) visit(i, j);
+        };
+
+        for (int i = m_Cells.CellBegin(cell); i < m_Cells.CellEnd(cell); ++i) {
+            for (int j = i + 1; j < m_Cells.CellEnd(cell); ++j) {
+                test(i, j);
+            }
+
+            for (int n = 0; n < neighbourCount; ++n) {
+                for (int j = m_Cells.CellBegin(neighbours[n]); j < m_Cells.CellEnd(neighbours[n]); ++j) {
+                    test(i, j);
+                }
+            }
+        }
+    };
+
+    // Count, then fill, so the lists can be built in parallel straight into one array
+    m_ListStarts.assign(count + 1, 0);
+
+    ParallelFor(pool, cellCount, [&](int cellBegin, int cellEnd, int) {
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            forEachPair(cell, [&](int i, int) { ++m_ListStarts[i + 1]; });
+        }
+    });
+
+    for (int i = 0; i < count; ++i) {
+        m_ListStarts[i + 1] += m_ListStarts[i];
+    }
+
+    m_Neighbours.resize(m_ListStarts[count]);
+
+    int largestCell = 0;
+    for (int cell = 0; cell < cellCount; ++cell) {
+        largestCell = std::max(largestCell, m_Cells.CellEnd(cell) - m_Cells.CellBegin(cell));
+    }
+
+    ParallelFor(pool, cellCount, [&](int cellBegin, int cellEnd, int) {
+        ScratchScope scratch{ };
+        int* cursor = scratch.Allocate<int>(largestCell);
+
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            const int cellStart = m_Cells.CellBegin(cell);
+            std::copy(m_ListStarts.begin() + cellStart, m_ListStarts.begin() + m_Cells.CellEnd(cell), cursor);
+
+            forEachPair(cell, [&](int i, int j) { m_Neighbours[cursor[i - cellStart]++] = j; });
+        }
+    });
+
+    m_Valid = true;
+    m_BuildCutoff = cutoff;
+    m_BuildSkin = skin;
+
+    ++m_RebuildCount;
+    m_AverageListLength = count > 0 ? (float)m_Neighbours.size() / count : 0.0f;
+}
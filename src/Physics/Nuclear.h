@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CellList.h"
+#include "CpuFeatures.h"
+#include "ForceAccumulator.h"
+#include "Particles.h"
+
+enum class NuclearSolver {
+    Direct,
+    CellList,
+    NeighbourList
+};
+
+// Strong force between every pair of nucleons in [begin, end), each pair is evaluated once and
+// applied to both nucleons with opposite signs, using the row kernel for simdLevel. With periodic
+// set the nearest image of each pair is used. forces is indexed like particles.
+void NuclearForces(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+// Strong force on the targetCount nucleons in targets from every nucleon in [begin, end), only
+// their entries of forces are written. See DirectCoulombForcesOn.
+void NuclearForcesOn(const Particles& particles, int begin, int end, const int* targets, int targetCount, bool periodic, float boxSize, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+// Strong force with a cutoff, only pairs in the same or adjacent cells of a grid rebuilt every
+// call are visited, so the cost grows linearly with the number of nucleons at a fixed density.
+//
+// The force is switched off smoothly over the last unit of distance before the cutoff (one
+// Yukawa range). The attraction grows with distance, so a nucleus only holds together while the
+// cutoff spans most of it: 8 keeps Oganesson bound, at 5 or 6 it flies apart. Cutting the force
+// also caps the depth of the potential well, so a cutoff just below the size of the starting
+// lattice (10 for Oganesson) lets the energy released as the lattice collapses throw nucleons out.
+// The savings come from scenes with many nuclei or bulk matter, where most pairs are far beyond
+// the cutoff.
+class NuclearCellList {
+public:
+    float cutoff{ 8.0f };
+    float cellSize{ 8.0f };   // Raised to the cutoff if smaller
+
+    void Evaluate(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+    const CellList& GetCellList() const { return m_Cells; }
+
+private:
+    CellList m_Cells;
+    Vec3Array m_SortedForces;
+};
+
+// Strong force over persistent per nucleon neighbour lists (Verlet lists) with the same switched
+// cutoff as NuclearCellList. Each list holds the nucleons within cutoff + skin, found through a
+// cell list, and is kept until some nucleon has moved more than half the skin since it was built:
+// two nucleons then cannot have closed a gap of more than the skin, so no pair inside the cutoff
+// is missing. Between rebuilds a step only gathers the new positions and walks the lists.
+class NuclearNeighbourList {
+public:
+    float cutoff{ 8.0f };
+    float skin{ 1.0f };
+
+    void Evaluate(const Particles& particles, int begin, int end, bool periodic, float boxSize, ForceAccumulator& accumulator, ThreadPool& pool, SimdLevel simdLevel, Vec3Array& forces);
+
+    // Forces a rebuild on the next Evaluate, for when the particles are replaced
+    void Invalidate() { m_Valid = false; }
+
+    int GetStepCount() const { return m_StepCount; }
+    int GetRebuildCount() const { return m_RebuildCount; }
+
+    // Mean number of partners per nucleon in the last build, every pair is stored once
+    float GetAverageListLength() const { return m_AverageListLength; }
+
+private:
+    bool Moved(const Particles& particles, ThreadPool& pool);
+    void Build(const Particles& particles, int begin, int end, ThreadPool& pool);
+
+    CellList m_Cells;
+
+    // Lists are in the cell order of the last build, m_Order maps back to particle indices
+    std::vector<int> m_Order;
+    std::vector<int> m_ListStarts;
+    std::vector<int> m_Neighbours;
+
+    Vec3Array m_Positions;
+    Vec3Array m_BuildPositions;
+    AlignedVector<float> m_Charges;
+    Vec3Array m_SortedForces;
+
+    std::vector<float> m_TaskDisplacements;
+
+    bool m_Valid{ false };
+    int m_Begin{ 0 };
+    int m_End{ 0 };
+    bool m_Periodic{ false };
+    float m_BoxSize{ 0.0f };
+    float m_BuildCutoff{ 0.0f };
+    float m_BuildSkin{ 0.0f };
+
+    int m_StepCount{ 0 };
+    int m_RebuildCount{ 0 };
+    float m_AverageListLength{ 0.0f };
+};
@@ -0,0 +1,143 @@
+#include "PairKernels.h"
+
+namespace {
+    // Force of one nucleon pair on i, also subtracted from fx/fy/fz[j]
+    glm::vec3 NuclearPairScalar(const PairRow& row, int i, int j) {
+        float dx = row.x[i] - row.x[j];
+        float dy = row.y[i] - row.y[j];
+        float dz = row.z[i] - row.z[j];
+
+        if (row.periodic) {
+            dx -= row.boxSize * glm::round(dx * row.inverseBoxSize);
+            dy -= row.boxSize * glm::round(dy * row.inverseBoxSize);
+            dz -= row.boxSize * glm::round(dz * row.inverseBoxSize);
+        }
+
+        float distanceSquared = dx * dx + dy * dy + dz * dz;
+        float distance = glm::sqrt(distanceSquared);
+        float inverseDistance = 1.0f / distance;
+
+        // Using Yukawa Potential as an approximation:
+        // U(r) = (e^(-r)) / r
+        // -> F(r) = -(e^(-r) * r^(-1) + e^(-r) * r^(-2))
+
+        // Where r is the distance between the nucleons
+
+        // We then finally add 1 / r^(10) to the force to act as a repulsive core
+        // here 10 is an arbitrary large number
+
+        // F(r) = 1 / r^(10) -(e^(-r) * r^(-1) + e^(-r) * r^(-2))
+
+        float exponential = glm::exp(distance);
+        float distance10 = distanceSquared * distanceSquared * distanceSquared * distanceSquared * distanceSquared;
+
+        float magnitude = 1.0f / distance10 - (exponential * inverseDistance * inverseDistance + exponential * inverseDistance);
+
+        if (row.cutoff > 0.0f) {
+            // Smoothstep from 1 inside the switching region to 0 at the cutoff
+            float t = glm::clamp((row.cutoff - distance) * row.inverseSwitchWidth, 0.0f, 1.0f);
+            magnitude *= t * t * (3.0f - 2.0f * t);
+        }
+
+        float scale = magnitude * inverseDistance;
+
+        if (row.fx) {
+            row.fx[j] -= scale * dx;
+            row.fy[j] -= scale * dy;
+            row.fz[j] -= scale * dz;
+        }
+
+        return glm::vec3{ scale * dx, scale * dy, scale * dz };
+    }
+
+    // The row kernels return plain floats so that the instruction set translation units never
+    // include glm, the conversion happens here
+    template<PairForce(*Kernel)(const PairRow&)>
+    glm::vec3 KernelVec3(const PairRow& row) {
+        PairForce force = Kernel(row);
+
+        return glm::vec3{ force.x, force.y, force.z };
+    }
+}
+
+PairForce CoulombRowScalar(const PairRow& row) {
+    const int i = row.i;
+
+    float forceX = 0.0f;
+    float forceY = 0.0f;
+    float forceZ = 0.0f;
+
+    for (int j = row.jBegin; j < row.jEnd; ++j) {
+        float dx = row.x[i] - row.x[j];
+        float dy = row.y[i] - row.y[j];
+        float dz = row.z[i] - row.z[j];
+
+        float inverseDistance = 1.0f / glm::sqrt(dx * dx + dy * dy + dz * dz);
+
+        // q1 * q2 / r^2 along the unit vector offset / r
+        float scale = row.charge[i] * row.charge[j] * inverseDistance * inverseDistance * inverseDistance;
+
+        forceX += scale * dx;
+        forceY += scale * dy;
+        forceZ += scale * dz;
+
+        if (row.fx) {
+            row.fx[j] -= scale * dx;
+            row.fy[j] -= scale * dy;
+            row.fz[j] -= scale * dz;
+        }
+    }
+
+    return PairForce{ forceX, forceY, forceZ };
+}
+
+PairForce NuclearRowScalar(const PairRow& row) {
+    const int i = row.i;
+
+    glm::vec3 force{ 0.0f };
+
+    for (int j = row.jBegin; j < row.jEnd; ++j) {
+        force += NuclearPairScalar(row, i, j);
+    }
+
+    return PairForce{ force.x, force.y, force.z };
+}
+
+PairForce NuclearListScalar(const PairRow& row) {
+    const int i = row.i;
+
+    glm::vec3 force{ 0.0f };
+
+    for (int n = row.jBegin; n < row.jEnd; ++n) {
+        force += NuclearPairScalar(row, i, row.neighbours[n]);
+    }
+
+    return PairForce{ force.x, force.y, force.z };
+}
+
+PairRowKernel GetCoulombRowKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return KernelVec3<CoulombRowSse4>;
+        case SimdLevel::Avx2: return KernelVec3<CoulombRowAvx2>;
+        case SimdLevel::Avx512: return KernelVec3<CoulombRowAvx512>;
+        default: return KernelVec3<CoulombRowScalar>;
+    }
+}
+
+PairRowKernel GetNuclearRowKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return KernelVec3<NuclearRowSse4>;
+        case SimdLevel::Avx2: return KernelVec3<NuclearRowAvx2>;
+        case SimdLevel::Avx512: return KernelVec3<NuclearRowAvx512>;
+        default: return KernelVec3<NuclearRowScalar>;
+    }
+}
+
+PairRowKernel GetNuclearListKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return KernelVec3<NuclearListSse4>;
+        case SimdLevel::Avx2: return KernelVec3<NuclearListAvx2>;
+        case SimdLevel::Avx512: return KernelVec3<NuclearListAvx512>;
+        default: return KernelVec3<NuclearListScalar>;
+    }
+}
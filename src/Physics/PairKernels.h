@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "CpuFeatures.h"
+#include "PairRow.h"
+
+using PairRowKernel = glm::vec3(*)(const PairRow& row);
+
+// Coulomb q_i * q_j / r^2 row kernel for the given instruction set
+PairRowKernel GetCoulombRowKernel(SimdLevel level);
+
+// Yukawa plus repulsive core row kernel for the given instruction set
+PairRowKernel GetNuclearRowKernel(SimdLevel level);
+
+// Same force over a neighbour list, neighbours must not repeat within a row
+PairRowKernel GetNuclearListKernel(SimdLevel level);
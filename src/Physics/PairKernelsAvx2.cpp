@@ -0,0 +1,47 @@
+#include "PairKernelsSimd.h"
+#include "ReplicaKernelsSimd.h"
+
+#include <immintrin.h>
+
+namespace {
+    struct Avx2 {
+        using Type = __m256;
+        static constexpr int width = 8;
+
+        static Type Zero() { return _mm256_setzero_ps(); }
+        static Type Set(float value) { return _mm256_set1_ps(value); }
+        static Type Load(const float* pointer) { return _mm256_loadu_ps(pointer); }
+        static void Store(float* pointer, Type value) { _mm256_storeu_ps(pointer, value); }
+        static Type Gather(const float* base, const int* indices) { return _mm256_i32gather_ps(base, _mm256_loadu_si256((const __m256i*)indices), 4); }
+
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Fma(Type a, Type b, Type c) { return _mm256_fmadd_ps(a, b, c); }
+        static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+        static Type Round(Type a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Type ReciprocalSqrtEstimate(Type a) { return _mm256_rsqrt_ps(a); }
+
+        static Type ScaleByPowerOfTwo(Type a, Type n) {
+            __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+            return _mm256_mul_ps(a, _mm256_castsi256_ps(exponent));
+        }
+
+        static float Sum(Type a) {
+            __m128 sums = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+            __m128 shuffled = _mm_movehdup_ps(sums);
+            sums = _mm_add_ps(sums, shuffled);
+            shuffled = _mm_movehl_ps(shuffled, sums);
+            sums = _mm_add_ss(sums, shuffled);
+            return _mm_cvtss_f32(sums);
+        }
+    };
+}
+
+PairForce CoulombRowAvx2(const PairRow& row) { return CoulombRowSimd<Avx2>(row); }
+PairForce NuclearRowAvx2(const PairRow& row) { return NuclearRowSimd<Avx2>(row); }
+PairForce NuclearListAvx2(const PairRow& row) { return NuclearListSimd<Avx2>(row); }
+
+void ReplicaForcesAvx2(const ReplicaLanes& lanes) { ReplicaForcesSimd<Avx2>(lanes); }
+void StepReplicasAvx2(const ReplicaLanes& lanes, float dt, int stepCount) { StepReplicasSimd<Avx2>(lanes, dt, stepCount); }
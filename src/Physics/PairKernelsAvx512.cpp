@@ -0,0 +1,35 @@
+#include "PairKernelsSimd.h"
+#include "ReplicaKernelsSimd.h"
+
+#include <immintrin.h>
+
+namespace {
+    struct Avx512 {
+        using Type = __m512;
+        static constexpr int width = 16;
+
+        static Type Zero() { return _mm512_setzero_ps(); }
+        static Type Set(float value) { return _mm512_set1_ps(value); }
+        static Type Load(const float* pointer) { return _mm512_loadu_ps(pointer); }
+        static void Store(float* pointer, Type value) { _mm512_storeu_ps(pointer, value); }
+        static Type Gather(const float* base, const int* indices) { return _mm512_i32gather_ps(_mm512_loadu_si512(indices), base, 4); }
+
+        static Type Add(Type a, Type b) { return _mm512_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm512_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm512_mul_ps(a, b); }
+        static Type Fma(Type a, Type b, Type c) { return _mm512_fmadd_ps(a, b, c); }
+        static Type Min(Type a, Type b) { return _mm512_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm512_max_ps(a, b); }
+        static Type Round(Type a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Type ReciprocalSqrtEstimate(Type a) { return _mm512_rsqrt14_ps(a); }
+        static Type ScaleByPowerOfTwo(Type a, Type n) { return _mm512_scalef_ps(a, n); }
+        static float Sum(Type a) { return _mm512_reduce_add_ps(a); }
+    };
+}
+
+PairForce CoulombRowAvx512(const PairRow& row) { return CoulombRowSimd<Avx512>(row); }
+PairForce NuclearRowAvx512(const PairRow& row) { return NuclearRowSimd<Avx512>(row); }
+PairForce NuclearListAvx512(const PairRow& row) { return NuclearListSimd<Avx512>(row); }
+
+void ReplicaForcesAvx512(const ReplicaLanes& lanes) { ReplicaForcesSimd<Avx512>(lanes); }
+void StepReplicasAvx512(const ReplicaLanes& lanes, float dt, int stepCount) { StepReplicasSimd<Avx512>(lanes, dt, stepCount); }
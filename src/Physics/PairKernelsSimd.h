@@ -0,0 +1,247 @@
+#pragma once
+
+#include "PairRow.h"
+
+// Shared bodies of the vector row kernels. V wraps one instruction set: its register type,
+// lane count and the handful of operations used below. It is defined in the translation unit
+// compiled for that instruction set, so each instantiation only ever runs on hardware that
+// supports it. Lanes past the last full register are handed to the scalar kernel.
+
+// e^x for every lane, Cephes style: x = n ln2 + r, e^r from a degree 6 polynomial, 2^n through
+// the exponent bits. Inputs are clamped to the range where the result is a finite float.
+template<typename V>
+typename V::Type ExpSimd(typename V::Type x) {
+    using T = typename V::Type;
+
+    x = V::Min(V::Max(x, V::Set(-87.3365447505f)), V::Set(88.3762626647949f));
+
+    T n = V::Round(V::Mul(x, V::Set(1.44269504088896341f)));
+
+    T r = V::Fma(n, V::Set(-0.693359375f), x);
+    r = V::Fma(n, V::Set(2.12194440e-4f), r);
+
+    T p = V::Set(1.9875691500e-4f);
+    p = V::Fma(p, r, V::Set(1.3981999507e-3f));
+    p = V::Fma(p, r, V::Set(8.3334519073e-3f));
+    p = V::Fma(p, r, V::Set(4.1665795894e-2f));
+    p = V::Fma(p, r, V::Set(1.6666665459e-1f));
+    p = V::Fma(p, r, V::Set(5.0000001201e-1f));
+
+    T y = V::Fma(V::Mul(p, r), r, V::Add(r, V::Set(1.0f)));
+
+    return V::ScaleByPowerOfTwo(y, n);
+}
+
+// Approximate reciprocal square root refined with one Newton-Raphson step
+template<typename V>
+typename V::Type InverseSqrtSimd(typename V::Type x) {
+    using T = typename V::Type;
+
+    T estimate = V::ReciprocalSqrtEstimate(x);
+
+    // y * (1.5 - 0.5 * x * y^2)
+    T halfX = V::Mul(x, V::Set(0.5f));
+    T correction = V::Fma(V::Mul(halfX, estimate), V::Mul(estimate, V::Set(-1.0f)), V::Set(1.5f));
+
+    return V::Mul(estimate, correction);
+}
+
+template<typename V>
+PairForce CoulombRowSimd(const PairRow& row) {
+    using T = typename V::Type;
+
+    const int i = row.i;
+
+    const T xi = V::Set(row.x[i]);
+    const T yi = V::Set(row.y[i]);
+    const T zi = V::Set(row.z[i]);
+    const T qi = V::Set(row.charge[i]);
+
+    const bool reactions = row.fx != nullptr;
+
+    T forceX = V::Zero();
+    T forceY = V::Zero();
+    T forceZ = V::Zero();
+
+    int j = row.jBegin;
+
+    for (; j + V::width <= row.jEnd; j += V::width) {
+        T dx = V::Sub(xi, V::Load(row.x + j));
+        T dy = V::Sub(yi, V::Load(row.y + j));
+        T dz = V::Sub(zi, V::Load(row.z + j));
+
+        T distanceSquared = V::Fma(dz, dz, V::Fma(dy, dy, V::Mul(dx, dx)));
+        T inverseDistance = InverseSqrtSimd<V>(distanceSquared);
+
+        T scale = V::Mul(V::Mul(qi, V::Load(row.charge + j)), V::Mul(V::Mul(inverseDistance, inverseDistance), inverseDistance));
+
+        forceX = V::Fma(scale, dx, forceX);
+        forceY = V::Fma(scale, dy, forceY);
+        forceZ = V::Fma(scale, dz, forceZ);
+
+        if (reactions) {
+            V::Store(row.fx + j, V::Sub(V::Load(row.fx + j), V::Mul(scale, dx)));
+            V::Store(row.fy + j, V::Sub(V::Load(row.fy + j), V::Mul(scale, dy)));
+            V::Store(row.fz + j, V::Sub(V::Load(row.fz + j), V::Mul(scale, dz)));
+        }
+    }
+
+    PairRow tail = row;
+    tail.jBegin = j;
+
+    PairForce force = CoulombRowScalar(tail);
+    force.x += V::Sum(forceX);
+    force.y += V::Sum(forceY);
+    force.z += V::Sum(forceZ);
+
+    return force;
+}
+
+// Nuclear force of the pairs with offsets dx, dy, dz as a multiple of the offset, the offsets are
+// replaced by their nearest images in a periodic box
+template<typename V>
+typename V::Type NuclearScaleSimd(const PairRow& row, typename V::Type& dx, typename V::Type& dy, typename V::Type& dz) {
+    using T = typename V::Type;
+
+    if (row.periodic) {
+        const T boxSize = V::Set(row.boxSize);
+        const T inverseBoxSize = V::Set(row.inverseBoxSize);
+
+        dx = V::Sub(dx, V::Mul(boxSize, V::Round(V::Mul(dx, inverseBoxSize))));
+        dy = V::Sub(dy, V::Mul(boxSize, V::Round(V::Mul(dy, inverseBoxSize))));
+        dz = V::Sub(dz, V::Mul(boxSize, V::Round(V::Mul(dz, inverseBoxSize))));
+    }
+
+    T distanceSquared = V::Fma(dz, dz, V::Fma(dy, dy, V::Mul(dx, dx)));
+    T inverseDistance = InverseSqrtSimd<V>(distanceSquared);
+    T distance = V::Mul(distanceSquared, inverseDistance);
+
+    // Same force as NuclearRowScalar: 1 / r^10 - (e^r / r^2 + e^r / r)
+    T inverseDistance2 = V::Mul(inverseDistance, inverseDistance);
+    T inverseDistance4 = V::Mul(inverseDistance2, inverseDistance2);
+    T inverseDistance10 = V::Mul(V::Mul(inverseDistance4, inverseDistance4), inverseDistance2);
+
+    T exponential = ExpSimd<V>(distance);
+
+    T attraction = V::Mul(exponential, V::Add(inverseDistance2, inverseDistance));
+    T magnitude = V::Sub(inverseDistance10, attraction);
+
+    if (row.cutoff > 0.0f) {
+        T t = V::Mul(V::Sub(V::Set(row.cutoff), distance), V::Set(row.inverseSwitchWidth));
+        t = V::Min(V::Max(t, V::Zero()), V::Set(1.0f));
+
+        magnitude = V::Mul(magnitude, V::Mul(V::Mul(t, t), V::Fma(t, V::Set(-2.0f), V::Set(3.0f))));
+    }
+
+    return V::Mul(magnitude, inverseDistance);
+}
+
+template<typename V>
+PairForce NuclearRowSimd(const PairRow& row) {
+    using T = typename V::Type;
+
+    const int i = row.i;
+
+    const T xi = V::Set(row.x[i]);
+    const T yi = V::Set(row.y[i]);
+    const T zi = V::Set(row.z[i]);
+
+    const bool reactions = row.fx != nullptr;
+
+    T forceX = V::Zero();
+    T forceY = V::Zero();
+    T forceZ = V::Zero();
+
+    int j = row.jBegin;
+
+    for (; j + V::width <= row.jEnd; j += V::width) {
+        T dx = V::Sub(xi, V::Load(row.x + j));
+        T dy = V::Sub(yi, V::Load(row.y + j));
+        T dz = V::Sub(zi, V::Load(row.z + j));
+
+        T scale = NuclearScaleSimd<V>(row, dx, dy, dz);
+
+        forceX = V::Fma(scale, dx, forceX);
+        forceY = V::Fma(scale, dy, forceY);
+        forceZ = V::Fma(scale, dz, forceZ);
+
+        if (reactions) {
+            V::Store(row.fx + j, V::Sub(V::Load(row.fx + j), V::Mul(scale, dx)));
+            V::Store(row.fy + j, V::Sub(V::Load(row.fy + j), V::Mul(scale, dy)));
+            V::Store(row.fz + j, V::Sub(V::Load(row.fz + j), V::Mul(scale, dz)));
+        }
+    }
+
+    PairRow tail = row;
+    tail.jBegin = j;
+
+    PairForce force = NuclearRowScalar(tail);
+    force.x += V::Sum(forceX);
+    force.y += V::Sum(forceY);
+    force.z += V::Sum(forceZ);
+
+    return force;
+}
+
+// Neighbour list version: positions are gathered, the force is computed in full registers and
+// the reactions are written back one lane at a time
+template<typename V>
+PairForce NuclearListSimd(const PairRow& row) {
+    using T = typename V::Type;
+
+    const int i = row.i;
+
+    const T xi = V::Set(row.x[i]);
+    const T yi = V::Set(row.y[i]);
+    const T zi = V::Set(row.z[i]);
+
+    T forceX = V::Zero();
+    T forceY = V::Zero();
+    T forceZ = V::Zero();
+
+    float reactionX[V::width];
+    float reactionY[V::width];
+    float reactionZ[V::width];
+
+    int n = row.jBegin;
+
+    for (; n + V::width <= row.jEnd; n += V::width) {
+        const int* j = row.neighbours + n;
+
+        T dx = V::Sub(xi, V::Gather(row.x, j));
+        T dy = V::Sub(yi, V::Gather(row.y, j));
+        T dz = V::Sub(zi, V::Gather(row.z, j));
+
+        T scale = NuclearScaleSimd<V>(row, dx, dy, dz);
+
+        T pairX = V::Mul(scale, dx);
+        T pairY = V::Mul(scale, dy);
+        T pairZ = V::Mul(scale, dz);
+
+        forceX = V::Add(forceX, pairX);
+        forceY = V::Add(forceY, pairY);
+        forceZ = V::Add(forceZ, pairZ);
+
+        if (row.fx) {
+            V::Store(reactionX, pairX);
+            V::Store(reactionY, pairY);
+            V::Store(reactionZ, pairZ);
+
+            for (int lane = 0; lane < V::width; ++lane) {
+                row.fx[j[lane]] -= reactionX[lane];
+                row.fy[j[lane]] -= reactionY[lane];
+                row.fz[j[lane]] -= reactionZ[lane];
+            }
+        }
+    }
+
+    PairRow tail = row;
+    tail.jBegin = n;
+
+    PairForce force = NuclearListScalar(tail);
+    force.x += V::Sum(forceX);
+    force.y += V::Sum(forceY);
+    force.z += V::Sum(forceZ);
+
+    return force;
+}
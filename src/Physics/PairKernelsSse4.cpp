@@ -0,0 +1,46 @@
+#include "PairKernelsSimd.h"
+#include "ReplicaKernelsSimd.h"
+
+#include <smmintrin.h>
+
+namespace {
+    struct Sse4 {
+        using Type = __m128;
+        static constexpr int width = 4;
+
+        static Type Zero() { return _mm_setzero_ps(); }
+        static Type Set(float value) { return _mm_set1_ps(value); }
+        static Type Load(const float* pointer) { return _mm_loadu_ps(pointer); }
+        static void Store(float* pointer, Type value) { _mm_storeu_ps(pointer, value); }
+        static Type Gather(const float* base, const int* indices) { return _mm_setr_ps(base[indices[0]], base[indices[1]], base[indices[2]], base[indices[3]]); }
+
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Fma(Type a, Type b, Type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+        static Type Round(Type a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Type ReciprocalSqrtEstimate(Type a) { return _mm_rsqrt_ps(a); }
+
+        static Type ScaleByPowerOfTwo(Type a, Type n) {
+            __m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23);
+            return _mm_mul_ps(a, _mm_castsi128_ps(exponent));
+        }
+
+        static float Sum(Type a) {
+            __m128 shuffled = _mm_movehdup_ps(a);
+            __m128 sums = _mm_add_ps(a, shuffled);
+            shuffled = _mm_movehl_ps(shuffled, sums);
+            sums = _mm_add_ss(sums, shuffled);
+            return _mm_cvtss_f32(sums);
+        }
+    };
+}
+
+PairForce CoulombRowSse4(const PairRow& row) { return CoulombRowSimd<Sse4>(row); }
+PairForce NuclearRowSse4(const PairRow& row) { return NuclearRowSimd<Sse4>(row); }
+PairForce NuclearListSse4(const PairRow& row) { return NuclearListSimd<Sse4>(row); }
+
+void ReplicaForcesSse4(const ReplicaLanes& lanes) { ReplicaForcesSimd<Sse4>(lanes); }
+void StepReplicasSse4(const ReplicaLanes& lanes, float dt, int stepCount) { StepReplicasSimd<Sse4>(lanes, dt, stepCount); }
@@ -0,0 +1,60 @@
+#pragma once
+
+// Pair kernel interface seen by the per instruction set translation units. It stays free of glm
+// and of any other shared inline code: an inline function compiled with AVX flags may be the
+// copy the linker keeps for the whole program, and would then run on processors without AVX.
+
+// One row of a half pair kernel: particle i against particles [jBegin, jEnd), or for the list
+// kernels against neighbours[jBegin, jEnd). The kernel subtracts every pair force from
+// fx/fy/fz[j], unless fx is null, and returns the total force on i.
+struct PairRow {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* charge;
+
+    float* fx;
+    float* fy;
+    float* fz;
+
+    const int* neighbours;
+
+    int i;
+    int jBegin;
+    int jEnd;
+
+    bool periodic;
+    float boxSize;
+    float inverseBoxSize;
+
+    // Nuclear kernels only: with a positive cutoff the force is smoothly switched off, from full
+    // strength at cutoff - 1 / inverseSwitchWidth down to zero at the cutoff
+    float cutoff;
+    float inverseSwitchWidth;
+};
+
+// Total force on i returned by a row kernel
+struct PairForce {
+    float x;
+    float y;
+    float z;
+};
+
+// Per instruction set implementations, each compiled in its own translation unit with the
+// matching code generation flags. Only call them after DetectSimdLevel reports support.
+PairForce CoulombRowSse4(const PairRow& row);
+PairForce NuclearRowSse4(const PairRow& row);
+PairForce NuclearListSse4(const PairRow& row);
+
+PairForce CoulombRowAvx2(const PairRow& row);
+PairForce NuclearRowAvx2(const PairRow& row);
+PairForce NuclearListAvx2(const PairRow& row);
+
+PairForce CoulombRowAvx512(const PairRow& row);
+PairForce NuclearRowAvx512(const PairRow& row);
+PairForce NuclearListAvx512(const PairRow& row);
+
+// Portable reference implementations, also used for the tails of the vector kernels
+PairForce CoulombRowScalar(const PairRow& row);
+PairForce NuclearRowScalar(const PairRow& row);
+PairForce NuclearListScalar(const PairRow& row);
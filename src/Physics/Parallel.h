@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "ThreadPool.h"
+
+// Number of tasks the helpers below split a loop of count iterations into. A few tasks per thread
+// leave room for stealing; the split only depends on the count and the pool size, so anything
+// indexed by task (per task force buffers for example) is laid out the same way every run.
+inline int ParallelTaskCount(const ThreadPool& pool, int count) {
+    if (pool.GetThreadCount() == 1) return 1;
+
+    return std::clamp(count, 1, pool.GetThreadCount() * 4);
+}
+
+// Splits [0, count) into ParallelTaskCount contiguous ranges and calls f(begin, end, task) for each
+template<typename Function>
+void ParallelFor(ThreadPool& pool, int count, Function&& f) {
+    const int taskCount = ParallelTaskCount(pool, count);
+
+    pool.Run(taskCount, [&](int task, int) {
+        f((int)((long long)count * task / taskCount), (int)((long long)count * (task + 1) / taskCount), task);
+    });
+}
+
+// First row of a task when the rows of a half pair loop (row r pairs with rows r + 1..rows - 1)
+// are split into taskCount ranges with the same number of pairs each
+inline int PairRowBoundary(int rows, int task, int taskCount) {
+    if (task <= 0) return 0;
+    if (task >= taskCount) return rows;
+
+    // Pairs before row r: r * (rows - 1) - r * (r - 1) / 2, solved for r
+    double n = rows;
+    double totalPairs = n * (n - 1.0) * 0.5;
+    double target = totalPairs * task / taskCount;
+    double b = 2.0 * n - 1.0;
+
+    double row = (b - std::sqrt(std::max(0.0, b * b - 8.0 * target))) * 0.5;
+
+    return std::clamp((int)std::ceil(row), 0, rows);
+}
+
+// Like ParallelFor over the rows of a half pair loop, but balanced by pair count rather than rows
+template<typename Function>
+void ParallelForPairs(ThreadPool& pool, int rows, Function&& f) {
+    const int taskCount = ParallelTaskCount(pool, rows);
+
+    pool.Run(taskCount, [&](int task, int) {
+        f(PairRowBoundary(rows, task, taskCount), PairRowBoundary(rows, task + 1, taskCount), task);
+    });
+}
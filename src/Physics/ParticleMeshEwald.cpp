@@ -0,0 +1,312 @@
+#include "ParticleMeshEwald.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "FFT.h"
+#include "Parallel.h"
+#include "Periodic.h"
+
+namespace {
+    const double pi = 3.14159265358979323846;
+
+    // Cardinal B-spline weights M_n(w + n - 1 - j) for j = 0..n-1 and their derivatives
+    void FillBSpline(double w, int order, double* weights, double* derivatives) {
+        weights[order - 1] = 0.0;
+        weights[1] = w;
+        weights[0] = 1.0 - w;
+
+        auto raise = [&](int k) {
+            double divisor = 1.0 / (k - 1);
+            weights[k - 1] = divisor * w * weights[k - 2];
+
+            for (int j = 1; j <= k - 2; ++j) {
+                weights[k - j - 1] = divisor * ((w + j) * weights[k - j - 2] + (k - j - w) * weights[k - j - 1]);
+            }
+
+            weights[0] = divisor * (1.0 - w) * weights[0];
+        };
+
+        for (int k = 3; k <= order - 1; ++k) {
+            raise(k);
+        }
+
+        if (derivatives) {
+            derivatives[0] = -weights[0];
+
+            for (int j = 1; j < order; ++j) {
+                derivatives[j] = weights[j - 1] - weights[j];
+            }
+        }
+
+        raise(order);
+    }
+
+    int NextPowerOfTwo(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+}
+
+void ParticleMeshEwald::Evaluate(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field) {
+    field.Assign(particles.Size());
+
+    if (end <= begin || boxSize <= 0.0f) return;
+
+    m_Cutoff = std::min((double)cutoff, 0.5 * boxSize);
+
+    // Solve erfc(beta * cutoff) = tolerance by bisection
+    double low = 0.0;
+    double high = 10.0 / m_Cutoff;
+    for (int i = 0; i < 64; ++i) {
+        double middle = 0.5 * (low + high);
+
+        if (std::erfc(middle * m_Cutoff) > tolerance) low = middle;
+        else high = middle;
+    }
+    m_Beta = 0.5 * (low + high);
+
+    Prepare(boxSize);
+
+    RealSpace(particles, begin, end, boxSize, pool, field);
+    Reciprocal(particles, begin, end, boxSize, pool, field);
+}
+
+void ParticleMeshEwald::Prepare(float boxSize) {
+    int mesh = NextPowerOfTwo(std::max(meshSize, 4));
+    int order = std::clamp(splineOrder, 3, std::min(mesh, 12));
+
+    if (mesh == m_Mesh && order == m_Order && boxSize == m_BoxSize && m_Beta == m_PreparedBeta) return;
+
+    m_Mesh = mesh;
+    m_Order = order;
+    m_BoxSize = boxSize;
+    m_PreparedBeta = m_Beta;
+
+    // Squared modulus of the B-spline Euler exponential factors, |b(m)|^2
+    std::vector<double> splineModuli(mesh);
+    {
+        std::vector<double> weights(order);
+        FillBSpline(0.0, order, weights.data(), nullptr);
+
+        for (int m = 0; m < mesh; ++m) {
+            std::complex<double> sum{ 0.0 };
+
+            for (int k = 0; k <= order - 2; ++k) {
+                double angle = 2.0 * pi * m * k / mesh;
+                sum += weights[order - 2 - k] * std::complex<double>{ std::cos(angle), std::sin(angle) };
+            }
+
+            splineModuli[m] = std::norm(sum);
+        }
+
+        // Odd orders vanish at the Nyquist frequency, borrow from the neighbours
+        for (int m = 0; m < mesh; ++m) {
+            if (splineModuli[m] < 1e-7) {
+                splineModuli[m] = 0.5 * (splineModuli[(m + mesh - 1) % mesh] + splineModuli[(m + 1) % mesh]);
+            }
+        }
+    }
+
+    double volume = (double)boxSize * boxSize * boxSize;
+
+    m_InfluenceFunction.assign((size_t)mesh * mesh * mesh, 0.0);
+
+    for (int z = 0; z < mesh; ++z) {
+        for (int y = 0; y < mesh; ++y) {
+            for (int x = 0; x < mesh; ++x) {
+                if (x == 0 && y == 0 && z == 0) continue;
+
+                double mx = (x <= mesh / 2 ? x : x - mesh) / (double)boxSize;
+                double my = (y <= mesh / 2 ? y : y - mesh) / (double)boxSize;
+                double mz = (z <= mesh / 2 ? z : z - mesh) / (double)boxSize;
+
+                double mSquared = mx * mx + my * my + mz * mz;
+
+                double c = std::exp(-pi * pi * mSquared / (m_Beta * m_Beta)) / (pi * volume * mSquared);
+
+                m_InfluenceFunction[((size_t)z * mesh + y) * mesh + x] = c / (splineModuli[x] * splineModuli[y] * splineModuli[z]);
+            }
+        }
+    }
+}
+
+void ParticleMeshEwald::RealSpace(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field) {
+    const double cutoffSquared = m_Cutoff * m_Cutoff;
+    const double beta = m_Beta;
+    const double gaussianFactor = 2.0 * beta / std::sqrt(pi);
+
+    // Every pair inside the cutoff is in the same or in adjacent cells
+    m_Cells.Build(particles, begin, end, (float)m_Cutoff, true, boxSize);
+
+    const Vec3Array& positions = m_Cells.GetPositions();
+    const AlignedVector<float>& charges = m_Cells.GetCharges();
+    const std::vector<int>& order = m_Cells.GetOrder();
+
+    // Each task sums the field on the charges of its own cells, so no two tasks write the same entry
+    ParallelFor(pool, m_Cells.GetCellCount(), [&](int cellBegin, int cellEnd, int) {
+        std::array<int, 27> neighbours;
+
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            const int neighbourCount = m_Cells.Neighbours(cell, neighbours);
+
+            for (int a = m_Cells.CellBegin(cell); a < m_Cells.CellEnd(cell); ++a) {
+                const glm::vec3 position = positions.Get(a);
+                glm::dvec3 sum{ 0.0 };
+
+                for (int n = 0; n < neighbourCount; ++n) {
+                    for (int b = m_Cells.CellBegin(neighbours[n]); b < m_Cells.CellEnd(neighbours[n]); ++b) {
+                        if (a == b) continue;
+
+                        glm::vec3 offset = MinimumImage(position - positions.Get(b), boxSize);
+                        glm::dvec3 r{ offset.x, offset.y, offset.z };
+
+                        double distanceSquared = glm::dot(r, r);
+                        if (distanceSquared >= cutoffSquared) continue;
+
+                        double distance = std::sqrt(distanceSquared);
+
+                        double magnitude = std::erfc(beta * distance) / distanceSquared + gaussianFactor * std::exp(-beta * beta * distanceSquared) / distance;
+
+                        sum += (charges[b] * magnitude / distance) * r;
+                    }
+                }
+
+                const int i = order[a];
+
+                field.x[i] += (float)sum.x;
+                field.y[i] += (float)sum.y;
+                field.z[i] += (float)sum.z;
+            }
+        }
+    });
+}
+
+void ParticleMeshEwald::Reciprocal(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field) {
+    const int mesh = m_Mesh;
+    const int order = m_Order;
+    const size_t cellCount = (size_t)mesh * mesh * mesh;
+    const int count = end - begin;
+
+    m_Base.resize((size_t)count * 3);
+    m_Weights.resize((size_t)count * 3 * order);
+    m_Derivatives.resize((size_t)count * 3 * order);
+
+    // One grid per thread rather than per task keeps the memory bounded for large meshes, the
+    // particles are still handed out by task index so each grid always receives the same ones
+    const int gridCount = std::max(1, std::min(pool.GetThreadCount(), count));
+
+    m_TaskGrids.resize(gridCount);
+    for (auto& grid : m_TaskGrids) {
+        grid.assign(cellCount, 0.0);
+    }
+
+    // Spread the charges, every task into its own grid
+    pool.Run(gridCount, [&](int task, int) {
+        std::vector<double>& grid = m_TaskGrids[task];
+
+        const int rangeBegin = (int)((long long)count * task / gridCount);
+        const int rangeEnd = (int)((long long)count * (task + 1) / gridCount);
+
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            const glm::vec3 position = WrapPosition(particles.Position(begin + i), boxSize);
+
+            for (int axis = 0; axis < 3; ++axis) {
+                double u = mesh * (double)position[axis] / boxSize;
+                double base = std::floor(u);
+
+                m_Base[i * 3 + axis] = (int)base - order + 1;
+                FillBSpline(u - base, order, &m_Weights[(i * 3 + axis) * order], &m_Derivatives[(i * 3 + axis) * order]);
+            }
+
+            const double* wx = &m_Weights[(i * 3 + 0) * order];
+            const double* wy = &m_Weights[(i * 3 + 1) * order];
+            const double* wz = &m_Weights[(i * 3 + 2) * order];
+
+            double charge = particles.charge[begin + i];
+
+            for (int c = 0; c < order; ++c) {
+                int z = (m_Base[i * 3 + 2] + c + mesh) % mesh;
+
+                for (int b = 0; b < order; ++b) {
+                    int y = (m_Base[i * 3 + 1] + b + mesh) % mesh;
+
+                    double weight = charge * wz[c] * wy[b];
+
+                    for (int a = 0; a < order; ++a) {
+                        int x = (m_Base[i * 3 + 0] + a + mesh) % mesh;
+
+                        grid[((size_t)z * mesh + y) * mesh + x] += weight * wx[a];
+                    }
+                }
+            }
+        }
+    });
+
+    // Sum the task grids in a fixed order so the result does not depend on scheduling
+    m_Grid.resize(cellCount);
+
+    ParallelFor(pool, (int)cellCount, [&](int cellBegin, int cellEnd, int) {
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            double sum = 0.0;
+
+            for (int t = 0; t < gridCount; ++t) {
+                sum += m_TaskGrids[t][cell];
+            }
+
+            m_Grid[cell] = sum;
+        }
+    });
+
+    FFT3D(m_Grid, mesh, false, pool);
+
+    ParallelFor(pool, (int)cellCount, [&](int cellBegin, int cellEnd, int) {
+        for (int cell = cellBegin; cell < cellEnd; ++cell) {
+            m_Grid[cell] *= m_InfluenceFunction[cell];
+        }
+    });
+
+    FFT3D(m_Grid, mesh, true, pool);
+
+    // Interpolate the field back with the spline derivatives
+    const double scale = mesh / (double)boxSize;
+
+    ParallelFor(pool, count, [&](int rangeBegin, int rangeEnd, int) {
+        for (int i = rangeBegin; i < rangeEnd; ++i) {
+            const double* wx = &m_Weights[(i * 3 + 0) * order];
+            const double* wy = &m_Weights[(i * 3 + 1) * order];
+            const double* wz = &m_Weights[(i * 3 + 2) * order];
+            const double* dx = &m_Derivatives[(i * 3 + 0) * order];
+            const double* dy = &m_Derivatives[(i * 3 + 1) * order];
+            const double* dz = &m_Derivatives[(i * 3 + 2) * order];
+
+            glm::dvec3 gradient{ 0.0 };
+
+            for (int c = 0; c < order; ++c) {
+                int z = (m_Base[i * 3 + 2] + c + mesh) % mesh;
+
+                for (int b = 0; b < order; ++b) {
+                    int y = (m_Base[i * 3 + 1] + b + mesh) % mesh;
+
+                    for (int a = 0; a < order; ++a) {
+                        int x = (m_Base[i * 3 + 0] + a + mesh) % mesh;
+
+                        double potential = m_Grid[((size_t)z * mesh + y) * mesh + x].real();
+
+                        gradient.x += dx[a] * wy[b] * wz[c] * potential;
+                        gradient.y += wx[a] * dy[b] * wz[c] * potential;
+                        gradient.z += wx[a] * wy[b] * dz[c] * potential;
+                    }
+                }
+            }
+
+            gradient *= scale;
+
+            field.x[begin + i] -= (float)gradient.x;
+            field.y[begin + i] -= (float)gradient.y;
+            field.z[begin + i] -= (float)gradient.z;
+        }
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "CellList.h"
+#include "Particles.h"
+#include "ThreadPool.h"
+
+// Smooth particle mesh Ewald (Essmann et al. 1995) for the Coulomb force in a cubic periodic box.
+//
+// The 1/r interaction is split into erfc(beta * r) / r, summed over minimum images inside the
+// real space cutoff, and erf(beta * r) / r, which is smooth and solved on a mesh: charges are
+// spread with cardinal B-splines, convolved with the Ewald influence function through an FFT,
+// and the field is interpolated back with the spline derivatives.
+//
+// beta is chosen so erfc(beta * cutoff) = tolerance. A larger cutoff moves work into the real
+// space sum and lets a coarser mesh reach the same accuracy, a smaller one does the opposite.
+class ParticleMeshEwald {
+public:
+    float cutoff{ 3.0f };
+    float tolerance{ 1e-5f };
+    int meshSize{ 32 };   // Rounded up to a power of two
+    int splineOrder{ 4 };
+
+    // Coulomb field (force per unit charge) at every particle in [begin, end), field is indexed like particles
+    void Evaluate(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field);
+
+    // Ewald splitting coefficient used by the last Evaluate
+    double GetSplittingCoefficient() const { return m_Beta; }
+
+private:
+    void Prepare(float boxSize);
+
+    void RealSpace(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field);
+    void Reciprocal(const Particles& particles, int begin, int end, float boxSize, ThreadPool& pool, Vec3Array& field);
+
+    double m_Beta{ 0.0 };
+    double m_Cutoff{ 0.0 };
+
+    int m_Mesh{ 0 };
+    int m_Order{ 0 };
+    float m_BoxSize{ 0.0f };
+    double m_PreparedBeta{ 0.0 };
+
+    // Charges binned by cells at least a cutoff wide, so the real space sum only visits neighbouring cells
+    CellList m_Cells;
+
+    std::vector<double> m_InfluenceFunction;
+    std::vector<std::complex<double>> m_Grid;
+    std::vector<std::vector<double>> m_TaskGrids;
+
+    // Per particle spline weights and derivatives, splineOrder values per axis, indexed by particle index - begin
+    std::vector<int> m_Base;
+    std::vector<double> m_Weights;
+    std::vector<double> m_Derivatives;
+};
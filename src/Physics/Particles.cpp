@@ -0,0 +1,70 @@
+#include "Particles.h"
+
+void Particles::Add(Species s, float particleMass, float particleCharge, const glm::vec3& position, const glm::vec3& velocity) {
+    x.push_back(position.x);
+    y.push_back(position.y);
+    z.push_back(position.z);
+
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    vz.push_back(velocity.z);
+
+    mass.push_back(particleMass);
+    inverseMass.push_back(1.0f / particleMass);
+    charge.push_back(particleCharge);
+    species.push_back(s);
+
+    ++m_Counts[(int)s];
+}
+
+void Particles::Remove(int i) {
+    for (auto* array : { &x, &y, &z, &vx, &vy, &vz, &mass, &inverseMass, &charge }) {
+        array->erase(array->begin() + i);
+    }
+
+    --m_Counts[(int)species[i]];
+    species.erase(species.begin() + i);
+}
+
+void Particles::Reserve(int count) {
+    for (auto* array : { &x, &y, &z, &vx, &vy, &vz, &mass, &inverseMass, &charge }) {
+        array->reserve(count);
+    }
+
+    species.reserve(count);
+}
+
+void Particles::Clear() {
+    for (auto* array : { &x, &y, &z, &vx, &vy, &vz, &mass, &inverseMass, &charge }) {
+        array->clear();
+    }
+
+    species.clear();
+
+    m_Counts = { };
+}
+
+void Particles::GroupBySpecies() {
+    std::array<int, 3> offsets{ 0, m_Counts[0], m_Counts[0] + m_Counts[1] };
+
+    std::vector<int> order(Size());
+    for (int i = 0; i < Size(); ++i) {
+        order[offsets[(int)species[i]]++] = i;
+    }
+
+    auto permute = [&](auto& array) {
+        auto permuted = array;
+
+        for (int i = 0; i < Size(); ++i) {
+            permuted[i] = array[order[i]];
+        }
+
+        array.swap(permuted);
+    };
+
+    for (auto* array : { &x, &y, &z, &vx, &vy, &vz, &mass, &inverseMass, &charge }) {
+        permute(*array);
+    }
+
+    permute(species);
+}
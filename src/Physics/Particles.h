@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "AlignedAllocator.h"
+
+enum class Species : std::uint8_t {
+    Electron,
+    Proton,
+    Neutron
+};
+
+// Three component vectors stored as one array per component
+struct Vec3Array {
+    AlignedVector<float> x;
+    AlignedVector<float> y;
+    AlignedVector<float> z;
+
+    int Size() const { return (int)x.size(); }
+
+    void Assign(int count, float value = 0.0f) {
+        x.assign(count, value);
+        y.assign(count, value);
+        z.assign(count, value);
+    }
+
+    glm::vec3 Get(int i) const { return glm::vec3{ x[i], y[i], z[i] }; }
+
+    void Set(int i, const glm::vec3& v) {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+};
+
+// Structure of arrays particle store.
+//
+// Particles are kept grouped by species, electrons first, then protons, then neutrons, so every
+// charged particle lies in [0, ChargedEnd()) and every nucleon in [NucleonBegin(), Size()).
+// Add appends without regrouping; call GroupBySpecies once a batch of particles has been added.
+class Particles {
+public:
+    AlignedVector<float> x, y, z;
+    AlignedVector<float> vx, vy, vz;
+    AlignedVector<float> mass;
+    AlignedVector<float> inverseMass;
+    AlignedVector<float> charge;
+    AlignedVector<Species> species;
+
+    int Size() const { return (int)x.size(); }
+
+    int Count(Species s) const { return m_Counts[(int)s]; }
+
+    int ChargedEnd() const { return Count(Species::Electron) + Count(Species::Proton); }
+    int NucleonBegin() const { return Count(Species::Electron); }
+
+    glm::vec3 Position(int i) const { return glm::vec3{ x[i], y[i], z[i] }; }
+    glm::vec3 Velocity(int i) const { return glm::vec3{ vx[i], vy[i], vz[i] }; }
+
+    void Add(Species s, float particleMass, float particleCharge, const glm::vec3& position, const glm::vec3& velocity);
+
+    // Removes particle i, the others keep their order so the species stay grouped
+    void Remove(int i);
+
+    void Reserve(int count);
+    void Clear();
+
+    // Stable reorder into electron, proton, neutron order
+    void GroupBySpecies();
+
+private:
+    std::array<int, 3> m_Counts{ };
+};
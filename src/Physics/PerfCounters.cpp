@@ -0,0 +1,141 @@
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+const char* PerfCounterName(PerfCounter counter) {
+    switch (counter) {
+        case PerfCounter::Cycles: return "Cycles";
+        case PerfCounter::Instructions: return "Instructions";
+        case PerfCounter::L1DataMisses: return "L1D Misses";
+        case PerfCounter::LastLevelMisses: return "LLC Misses";
+        case PerfCounter::BranchMisses: return "Branch Misses";
+        default: return "Unknown";
+    }
+}
+
+const char* PerfCounterKey(PerfCounter counter) {
+    switch (counter) {
+        case PerfCounter::Cycles: return "cycles";
+        case PerfCounter::Instructions: return "instructions";
+        case PerfCounter::L1DataMisses: return "l1d_misses";
+        case PerfCounter::LastLevelMisses: return "llc_misses";
+        case PerfCounter::BranchMisses: return "branch_misses";
+        default: return "unknown";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    Close();
+}
+
+#if defined(__linux__)
+
+namespace {
+    int OpenCounter(std::uint32_t type, std::uint64_t config, int groupFd) {
+        perf_event_attr attribute;
+        std::memset(&attribute, 0, sizeof(attribute));
+
+        attribute.size = sizeof(attribute);
+        attribute.type = type;
+        attribute.config = config;
+        attribute.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attribute.disabled = groupFd < 0;
+        attribute.exclude_kernel = 1;
+        attribute.exclude_hv = 1;
+
+        // This thread on whichever processor it runs
+        return (int)syscall(SYS_perf_event_open, &attribute, 0, -1, groupFd, 0);
+    }
+
+    std::uint64_t CacheMissConfig(std::uint64_t cache) {
+        return cache | ((std::uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) | ((std::uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+}
+
+bool PerfCounters::Open() {
+    Close();
+
+    struct Event {
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    const Event events[PerfCounterCount] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_L1D) },
+        { PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_LL) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    // The cycle counter leads the group, so all of them are scheduled on the processor together
+    for (int i = 0; i < PerfCounterCount; ++i) {
+        m_Fds[i] = OpenCounter(events[i].type, events[i].config, i == 0 ? -1 : m_Fds[0]);
+
+        if (m_Fds[i] >= 0) m_GroupIndex[i] = m_GroupSize++;
+        else if (i == 0) return false;
+    }
+
+    ioctl(m_Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return true;
+}
+
+void PerfCounters::Close() {
+    // The group leader last
+    for (int i = PerfCounterCount - 1; i >= 0; --i) {
+        if (m_Fds[i] >= 0) close(m_Fds[i]);
+
+        m_Fds[i] = -1;
+        m_GroupIndex[i] = -1;
+    }
+
+    m_GroupSize = 0;
+}
+
+bool PerfCounters::Read(PerfValues& values) const {
+    if (!IsOpen()) return false;
+
+    // The number of counters, the time the group was enabled and running, then the values
+    std::uint64_t buffer[3 + PerfCounterCount]{ };
+
+    if (read(m_Fds[0], buffer, sizeof(buffer)) < (ssize_t)(sizeof(std::uint64_t) * (3 + m_GroupSize))) return false;
+
+    const std::uint64_t enabled = buffer[1];
+    const std::uint64_t running = buffer[2];
+
+    if (running == 0) return false;
+
+    // Multiplexed, extrapolate to the whole time enabled
+    const double scale = running < enabled ? (double)enabled / (double)running : 1.0;
+
+    for (int i = 0; i < PerfCounterCount; ++i) {
+        const std::uint64_t count = m_GroupIndex[i] >= 0 ? buffer[3 + m_GroupIndex[i]] : 0;
+
+        values[i] = scale == 1.0 ? count : (std::uint64_t)((double)count * scale);
+    }
+
+    return true;
+}
+
+#else
+
+bool PerfCounters::Open() {
+    return false;
+}
+
+void PerfCounters::Close() { }
+
+bool PerfCounters::Read(PerfValues&) const {
+    return false;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Hardware performance counters of the calling thread, through perf_event_open on Linux. On other
+// platforms, or where the kernel does not allow it (perf_event_paranoid above 2, many virtual
+// machines), nothing opens and Read fails.
+//
+// When the processor has more events to count than counters, the kernel multiplexes them and the
+// group only counts part of the time. Read scales the counts up by the time enabled over the time
+// running, which makes them estimates rather than exact counts.
+//
+// The counters follow the thread that opened them and count user space only. Work a thread pool
+// hands to its other threads is not counted, so use a single thread for complete figures.
+
+enum class PerfCounter {
+    Cycles,
+    Instructions,
+    L1DataMisses,
+    LastLevelMisses,
+    BranchMisses,
+
+    Count
+};
+
+constexpr int PerfCounterCount = (int)PerfCounter::Count;
+
+const char* PerfCounterName(PerfCounter counter);
+
+// Lower case name for JSON and the like
+const char* PerfCounterKey(PerfCounter counter);
+
+using PerfValues = std::array<std::uint64_t, PerfCounterCount>;
+
+class PerfCounters {
+public:
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Opens every counter the processor and kernel support on the calling thread, false if not even
+    // the cycle counter could be opened
+    bool Open();
+    void Close();
+
+    bool IsOpen() const { return m_Fds[0] >= 0; }
+    bool IsAvailable(PerfCounter counter) const { return m_Fds[(int)counter] >= 0; }
+
+    // Counts since Open, read together in one system call. Counters that are not available read
+    // zero. False if nothing is open, the read failed or the group has not been scheduled yet, in
+    // which case values is left as it was and the sample should be dropped.
+    bool Read(PerfValues& values) const;
+
+private:
+    std::array<int, PerfCounterCount> m_Fds{ -1, -1, -1, -1, -1 };
+
+    // Position of each counter in a group read, the unavailable ones are left out of the group
+    std::array<int, PerfCounterCount> m_GroupIndex{ -1, -1, -1, -1, -1 };
+    int m_GroupSize{ 0 };
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Shortest offset between two particles in a cubic periodic box
+inline glm::vec3 MinimumImage(glm::vec3 offset, float boxSize) {
+    return offset - boxSize * glm::round(offset / boxSize);
+}
+
+// Maps a position back into [0, boxSize)
+inline glm::vec3 WrapPosition(glm::vec3 position, float boxSize) {
+    return position - boxSize * glm::floor(position / boxSize);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PhysicsState.h"
+#include "SpscQueue.h"
+
+enum class PhysicsCommandType {
+    LoadScene,
+    Clear,
+    SetTimeStep,
+    SetStepRate,
+    Pause,
+    Resume,
+    SingleStep,
+    AddParticle,
+    RemoveParticle,
+    MeasureCoulombError
+};
+
+// Request from the UI to the physics thread, which applies it between two steps. Only the fields
+// of the given type are used.
+struct PhysicsCommand {
+    PhysicsCommandType type{ PhysicsCommandType::Clear };
+
+    // LoadScene
+    PhysicsState scene{ };
+
+    // SetTimeStep: the time step, SetStepRate: steps per second
+    float value{ 0.0f };
+
+    // SetStepRate: run steps back to back, ignoring value
+    bool unlimited{ false };
+
+    // AddParticle
+    Species species{ Species::Electron };
+    glm::vec3 position{ 0.0f };
+    glm::vec3 velocity{ 0.0f };
+
+    // RemoveParticle
+    int index{ 0 };
+};
+
+using PhysicsCommandQueue = SpscQueue<PhysicsCommand, 256>;
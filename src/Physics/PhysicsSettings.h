@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Coulomb.h"
+#include "CpuFeatures.h"
+#include "Integrator.h"
+#include "Nuclear.h"
+
+// Solver and integrator choices made in the UI. The UI publishes its copy through a TripleBuffer
+// every frame and the physics thread takes the newest one between two steps, so a step never sees
+// a setting change halfway through. Defaults match those of the solvers.
+struct PhysicsSettings {
+    CoulombSolver coulombSolver{ CoulombSolver::Direct };
+    float barnesHutTheta{ 0.5f };
+    int fastMultipoleOrder{ 6 };
+    float fastMultipoleTheta{ 0.5f };
+    int fastMultipoleLeafCapacity{ 32 };
+
+    // Periodic boxes only
+    float ewaldCutoff{ 3.0f };
+    int ewaldMeshSize{ 32 };
+    int ewaldSplineOrder{ 4 };
+
+    NuclearSolver nuclearSolver{ NuclearSolver::Direct };
+    float nuclearCutoff{ 8.0f };
+    float nuclearCellSize{ 8.0f };
+    float nuclearSkin{ 1.0f };
+
+    IntegrationScheme integrationScheme{ IntegrationScheme::VelocityVerlet };
+    int blockMaxLevel{ 8 };
+    float blockAccuracy{ 0.01f };
+    int respaInnerSteps{ 4 };
+    float hermiteAccuracy{ 0.05f };
+    bool regularizeEncounters{ false };
+    float encounterDistance{ 0.5f };
+
+    bool useSmallAtom{ true };
+
+    SimdLevel simdLevel{ SimdLevel::Scalar };
+    int threadCount{ 1 };
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Particles.h"
+
+// What the solvers report about the last step. They keep these on the physics thread, which copies
+// them here when it publishes so the UI never reads a solver that is being stepped.
+struct PhysicsStatistics {
+    std::vector<int> blockLevelCounts;
+    float blockEvaluationsPerParticle{ 0.0f };
+    int hermiteSubstepCount{ 0 };
+    int regularizedPairCount{ 0 };
+    double ewaldCoefficient{ 0.0 };
+    glm::ivec3 nuclearCells{ 0 };
+    int neighbourListSteps{ 0 };
+    int neighbourListRebuilds{ 0 };
+    float neighbourListLength{ 0.0f };
+
+    // Relative force error of the approximate Coulomb solver, from the last MeasureCoulombError
+    float coulombError{ 0.0f };
+
+    // Wall clock time per step of the last batch
+    double stepSeconds{ 0.0 };
+};
+
+struct PhysicsState {
+    Particles particles;
+
+    // Cubic box [0, boxSize) with periodic images in every direction
+    bool periodic{ false };
+    float boxSize{ 0.0f };
+
+    PhysicsStatistics statistics;
+};
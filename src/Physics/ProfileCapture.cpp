@@ -0,0 +1,227 @@
+#include "ProfileCapture.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Collects the output in a large buffer and hands it to the stream in big writes
+    class TraceWriter {
+    public:
+        explicit TraceWriter(std::ofstream& file) : m_File{ file } {
+            m_Buffer.reserve(BufferSize + 1024);
+        }
+
+        ~TraceWriter() {
+            Flush();
+        }
+
+        void Write(const char* text) {
+            m_Buffer.append(text);
+            FlushIfFull();
+        }
+
+        // Scope and thread names are usually literals, but are escaped in case they are not
+        void WriteString(const char* text) {
+            m_Buffer.push_back('"');
+
+            for (const char* c = text; *c; ++c) {
+                if (*c == '"' || *c == '\\') m_Buffer.push_back('\\');
+
+                if ((unsigned char)*c < 0x20) m_Buffer.push_back(' ');
+                else m_Buffer.push_back(*c);
+            }
+
+            m_Buffer.push_back('"');
+            FlushIfFull();
+        }
+
+        void Write(std::uint64_t value) {
+            char digits[24];
+            char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+
+            m_Buffer.append(digits, end);
+        }
+
+        // Microseconds to the nanosecond, as the format expects
+        void WriteMicroseconds(std::uint64_t nanoseconds) {
+            Write(nanoseconds / 1000);
+            m_Buffer.push_back('.');
+
+            const std::uint64_t fraction = nanoseconds % 1000;
+            m_Buffer.push_back((char)('0' + fraction / 100));
+            m_Buffer.push_back((char)('0' + fraction / 10 % 10));
+            m_Buffer.push_back((char)('0' + fraction % 10));
+        }
+
+        void Flush() {
+            m_File.write(m_Buffer.data(), (std::streamsize)m_Buffer.size());
+            m_Buffer.clear();
+        }
+
+    private:
+        static constexpr size_t BufferSize = 1 << 20;
+
+        void FlushIfFull() {
+            if (m_Buffer.size() >= BufferSize) Flush();
+        }
+
+        std::ofstream& m_File;
+        std::string m_Buffer;
+    };
+}
+
+void ProfileCapture::Start() {
+    if (!m_Capturing) m_WasEnabled = Profiler::enabled.load(std::memory_order_relaxed);
+
+    m_Threads.clear();
+
+    // Calibrating takes a few milliseconds, better spent before the capture than during it
+    Profiler::NanosecondsPerTick();
+
+    m_StartTick = Profiler::Now();
+    m_LatestTick = m_StartTick;
+    m_DroppedCount = 0;
+
+    for (ProfileThread* thread : Profiler::Threads()) {
+        m_Threads.push_back(Thread{ thread, thread->GetWrittenCount(), { } });
+    }
+
+    m_Capturing = true;
+    Profiler::enabled.store(true, std::memory_order_relaxed);
+}
+
+void ProfileCapture::Update() {
+    if (!m_Capturing) return;
+
+    const std::vector<ProfileThread*> threads = Profiler::Threads();
+
+    // Threads that start during the capture are read from their first event
+    for (size_t i = m_Threads.size(); i < threads.size(); ++i) {
+        m_Threads.push_back(Thread{ threads[i], 0, { } });
+    }
+
+    for (Thread& thread : m_Threads) {
+        const size_t before = thread.events.size();
+        const std::uint64_t since = thread.readPosition;
+
+        thread.readPosition = thread.thread->Read(since, thread.events);
+
+        const std::uint64_t read = thread.events.size() - before;
+        m_DroppedCount += (thread.readPosition - since) - read;
+
+        // Scopes of a thread that started during the capture may have ended before it
+        auto started = std::remove_if(thread.events.begin() + before, thread.events.end(), [&](const ProfileEvent& event) { return event.end < m_StartTick; });
+        thread.events.erase(started, thread.events.end());
+
+        if (thread.events.size() > before) m_LatestTick = std::max(m_LatestTick, thread.events.back().end);
+    }
+
+    if (GetCapturedTime() >= duration) Stop();
+}
+
+void ProfileCapture::Stop() {
+    if (!m_Capturing) return;
+
+    m_Capturing = false;
+    Update();
+
+    Profiler::enabled.store(m_WasEnabled, std::memory_order_relaxed);
+}
+
+double ProfileCapture::GetCapturedTime() const {
+    return (double)(m_LatestTick - m_StartTick) * Profiler::NanosecondsPerTick() * 1.0e-9;
+}
+
+size_t ProfileCapture::GetEventCount() const {
+    size_t count = 0;
+
+    for (const Thread& thread : m_Threads) {
+        count += thread.events.size();
+    }
+
+    return count;
+}
+
+bool ProfileCapture::WriteChromeTrace(const std::string& path) const {
+    std::ofstream file{ path, std::ios::binary };
+
+    if (!file) {
+        std::cout << "ERROR: Could not open " << path << std::endl;
+        return false;
+    }
+
+    {
+        TraceWriter writer{ file };
+
+        const double nanosecondsPerTick = Profiler::NanosecondsPerTick();
+
+        auto toNanoseconds = [&](std::uint64_t tick) {
+            return tick > m_StartTick ? (std::uint64_t)((double)(tick - m_StartTick) * nanosecondsPerTick) : 0;
+        };
+
+        writer.Write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+        bool first = true;
+
+        for (const Thread& thread : m_Threads) {
+            const char* name = thread.thread->GetName();
+
+            writer.Write(first ? "" : ",\n");
+            first = false;
+
+            writer.Write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+            writer.Write((std::uint64_t)thread.thread->GetId());
+            writer.Write(",\"args\":{\"name\":");
+
+            if (name) writer.WriteString(name);
+            else writer.Write("\"Unnamed\"");
+
+            writer.Write("}}");
+        }
+
+        for (const Thread& thread : m_Threads) {
+            for (const ProfileEvent& event : thread.events) {
+                const std::uint64_t begin = toNanoseconds(event.begin);
+                const std::uint64_t end = toNanoseconds(event.end);
+
+                writer.Write(first ? "" : ",\n");
+                first = false;
+
+                writer.Write("{\"name\":");
+                writer.WriteString(event.name);
+                writer.Write(",\"ph\":\"X\",\"pid\":1,\"tid\":");
+                writer.Write((std::uint64_t)thread.thread->GetId());
+                writer.Write(",\"ts\":");
+                writer.WriteMicroseconds(begin);
+                writer.Write(",\"dur\":");
+                writer.WriteMicroseconds(end - begin);
+
+                if (event.counted) {
+                    writer.Write(",\"args\":{");
+
+                    for (int i = 0; i < PerfCounterCount; ++i) {
+                        writer.Write(i == 0 ? "\"" : ",\"");
+                        writer.Write(PerfCounterKey((PerfCounter)i));
+                        writer.Write("\":");
+                        writer.Write(event.counts[i]);
+                    }
+
+                    writer.Write("}");
+                }
+
+                writer.Write("}");
+            }
+        }
+
+        writer.Write("\n]}\n");
+    }
+
+    if (!file) {
+        std::cout << "ERROR: Could not write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+
+// Records every scope of every thread for a few seconds, to be written out as a Chrome trace and
+// opened in Perfetto or chrome://tracing. Starting a capture enables the profiler until it stops.
+//
+// The per thread buffers only hold the last few tens of thousands of scopes, so Update has to be
+// called often enough to drain them, every frame or every few thousand steps. Anything overwritten
+// before it was drained is counted as dropped.
+class ProfileCapture {
+public:
+    // Seconds after which Update stops the capture on its own
+    double duration{ 5.0 };
+
+    void Start();
+    void Update();
+    void Stop();
+
+    bool IsCapturing() const { return m_Capturing; }
+
+    // Seconds between the start and the newest event captured
+    double GetCapturedTime() const;
+
+    size_t GetEventCount() const;
+    std::uint64_t GetDroppedCount() const { return m_DroppedCount; }
+
+    // Writes the captured scopes in the Chrome Trace Event format, times in microseconds from the
+    // start of the capture. Returns false if the file could not be written.
+    bool WriteChromeTrace(const std::string& path) const;
+
+private:
+    struct Thread {
+        ProfileThread* thread;
+        std::uint64_t readPosition;
+        std::vector<ProfileEvent> events;
+    };
+
+    std::vector<Thread> m_Threads;
+
+    bool m_Capturing{ false };
+    bool m_WasEnabled{ false };
+
+    std::uint64_t m_StartTick{ 0 };
+    std::uint64_t m_LatestTick{ 0 };
+    std::uint64_t m_DroppedCount{ 0 };
+};
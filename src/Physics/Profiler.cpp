@@ -0,0 +1,219 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ProfileThread>> registry;
+
+    ProfileThread* Register() {
+        std::lock_guard lock{ registryMutex };
+
+        const int id = (int)registry.size();
+
+        registry.push_back(std::make_unique<ProfileThread>(id));
+
+        return registry.back().get();
+    }
+}
+
+std::uint64_t ProfileThread::Read(std::uint64_t since, std::vector<ProfileEvent>& events) const {
+    // The writer may already be filling position written, over the slot of written - Capacity, so
+    // the oldest event that is safe to copy is the one after that
+    const std::uint64_t written = m_Written.load(std::memory_order_acquire);
+    const std::uint64_t oldest = written >= (std::uint64_t)Capacity ? written - Capacity + 1 : 0;
+
+    const std::uint64_t first = std::max(since, oldest);
+    const size_t start = events.size();
+
+    // Seqlock style: the copies race with the writer on purpose and are plain, non-atomic struct
+    // copies, so ThreadSanitizer reports them. Torn events are dropped by the check below
+    for (std::uint64_t position = first; position < written; ++position) {
+        events.push_back(m_Events[position % Capacity]);
+    }
+
+    // Keeps the copies above from moving after the second load
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // Whatever the writer has reached since may have been overwritten while it was copied
+    const std::uint64_t writtenAfter = m_Written.load(std::memory_order_relaxed);
+    const std::uint64_t oldestAfter = writtenAfter >= (std::uint64_t)Capacity ? writtenAfter - Capacity + 1 : 0;
+
+    if (oldestAfter > first) {
+        const size_t overwritten = (size_t)std::min(oldestAfter - first, written - first);
+        events.erase(events.begin() + start, events.begin() + start + overwritten);
+    }
+
+    return written;
+}
+
+namespace {
+    struct Calibration {
+        std::uint64_t tickOrigin;
+        std::uint64_t nanosecondOrigin;
+        double nanosecondsPerTick;
+    };
+
+    const Calibration& GetCalibration() {
+        static const Calibration calibration = []() {
+            const std::uint64_t tickStart = Profiler::Now();
+            const std::uint64_t nanosecondStart = Profiler::SteadyNanoseconds();
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            const std::uint64_t tickEnd = Profiler::Now();
+            const std::uint64_t nanosecondEnd = Profiler::SteadyNanoseconds();
+
+            return Calibration{ tickStart, nanosecondStart, (double)(nanosecondEnd - nanosecondStart) / (double)(tickEnd - tickStart) };
+        }();
+
+        return calibration;
+    }
+}
+
+double Profiler::NanosecondsPerTick() {
+    return GetCalibration().nanosecondsPerTick;
+}
+
+std::uint64_t Profiler::ToNanoseconds(std::uint64_t ticks) {
+    const Calibration& calibration = GetCalibration();
+
+    const double offset = ((double)ticks - (double)calibration.tickOrigin) * calibration.nanosecondsPerTick;
+
+    return (std::uint64_t)((double)calibration.nanosecondOrigin + offset);
+}
+
+ProfileThread& Profiler::ThisThread() {
+    thread_local ProfileThread* thread = Register();
+
+    return *thread;
+}
+
+void Profiler::SetThreadName(const char* name) {
+    ThisThread().SetName(name);
+}
+
+std::vector<ProfileThread*> Profiler::Threads() {
+    std::lock_guard lock{ registryMutex };
+
+    std::vector<ProfileThread*> threads;
+
+    for (const auto& thread : registry) {
+        threads.push_back(thread.get());
+    }
+
+    return threads;
+}
+
+std::vector<ProfileStatistics> ComputeProfileStatistics(const std::vector<ProfileEvent>& events) {
+    std::vector<ProfileStatistics> statistics;
+    std::vector<std::vector<double>> durations;
+
+    const double microsecondsPerTick = Profiler::NanosecondsPerTick() * 1.0e-3;
+
+    for (const ProfileEvent& event : events) {
+        // Names are literals, but the same literal may have more than one address
+        auto it = std::find_if(statistics.begin(), statistics.end(), [&](const ProfileStatistics& s) {
+            return s.name == event.name || std::strcmp(s.name, event.name) == 0;
+        });
+
+        if (it == statistics.end()) {
+            statistics.push_back(ProfileStatistics{ event.name, event.depth, 0, 0.0, 0.0, 0.0, 0.0, 0, { } });
+            durations.emplace_back();
+            it = statistics.end() - 1;
+        }
+
+        durations[it - statistics.begin()].push_back((double)(event.end - event.begin) * microsecondsPerTick);
+
+        if (event.counted) {
+            ++it->countedCount;
+
+            for (int i = 0; i < PerfCounterCount; ++i) {
+                it->counts[i] += (double)event.counts[i];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < statistics.size(); ++i) {
+        std::vector<double>& samples = durations[i];
+        std::sort(samples.begin(), samples.end());
+
+        double sum = 0.0;
+        for (double sample : samples) sum += sample;
+
+        ProfileStatistics& s = statistics[i];
+        s.count = (int)samples.size();
+        s.minimum = samples.front();
+        s.average = sum / samples.size();
+        s.p99 = samples[std::min(samples.size() - 1, (size_t)(0.99 * samples.size()))];
+        s.maximum = samples.back();
+
+        if (s.countedCount > 0) {
+            for (double& count : s.counts) count /= s.countedCount;
+        }
+    }
+
+    return statistics;
+}
+
+void AccumulateProfileTotals(const std::vector<ProfileEvent>& events, std::vector<ProfileTotal>& totals) {
+    for (const ProfileEvent& event : events) {
+        auto it = std::find_if(totals.begin(), totals.end(), [&](const ProfileTotal& total) {
+            return total.name == event.name || std::strcmp(total.name, event.name) == 0;
+        });
+
+        if (it == totals.end()) {
+            totals.push_back(ProfileTotal{ event.name, event.depth, 0, 0, 0, { } });
+            it = totals.end() - 1;
+        }
+
+        ++it->count;
+        it->ticks += event.end - event.begin;
+
+        if (event.counted) {
+            ++it->countedCount;
+
+            for (int i = 0; i < PerfCounterCount; ++i) {
+                it->counts[i] += event.counts[i];
+            }
+        }
+    }
+}
+
+void ProfileHistory::Update() {
+    const std::vector<ProfileThread*> threads = Profiler::Threads();
+
+    for (size_t i = m_Threads.size(); i < threads.size(); ++i) {
+        m_Threads.push_back(Thread{ threads[i], 0, { } });
+    }
+
+    for (Thread& thread : m_Threads) {
+        thread.readPosition = thread.thread->Read(thread.readPosition, thread.events);
+
+        if (!thread.events.empty()) m_LatestTick = std::max(m_LatestTick, thread.events.back().end);
+    }
+
+    const std::uint64_t lengthTicks = (std::uint64_t)(length * 1.0e9 / Profiler::NanosecondsPerTick());
+    const std::uint64_t oldestTick = m_LatestTick > lengthTicks ? m_LatestTick - lengthTicks : 0;
+
+    for (Thread& thread : m_Threads) {
+        std::vector<ProfileEvent>& events = thread.events;
+
+        auto keep = std::find_if(events.begin(), events.end(), [&](const ProfileEvent& event) { return event.end >= oldestTick; });
+
+        if (events.end() - keep > maxEventCount) keep = events.end() - maxEventCount;
+
+        events.erase(events.begin(), keep);
+    }
+}
+
+void ProfileHistory::Clear() {
+    for (Thread& thread : m_Threads) {
+        thread.readPosition = thread.thread->GetWrittenCount();
+        thread.events.clear();
+    }
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "PerfCounters.h"
+
+// Named, nestable timing scopes, a ProfileScope at the top of a block records when it started and
+// ended into a ring buffer owned by the current thread. Recording takes two reads of the time stamp
+// counter and a store, nothing is shared between threads, and while the profiler is disabled a
+// scope only checks a flag. Names must be string literals or otherwise outlive the profiler.
+//
+// Each buffer has a single writer, its thread, and readers copy events out without stopping it.
+// A reader checks the write position again after copying and drops anything the writer may have
+// overwritten in the meantime, so a slow reader only loses the oldest events.
+//
+// With Profiler::countersEnabled set as well, every scope also reads the hardware counters of its
+// thread when it starts and ends, which costs two system calls, so it is only worth it for scopes
+// that take microseconds or more.
+
+struct ProfileEvent {
+    const char* name;
+
+    // Time stamp counter ticks, see Profiler::ToNanoseconds
+    std::uint64_t begin;
+    std::uint64_t end;
+
+    // Scopes open around this one on the same thread
+    int depth;
+
+    // Whether the hardware counters were read, and how far they moved during the scope
+    bool counted;
+    PerfValues counts;
+};
+
+class ProfileThread {
+public:
+    static constexpr int Capacity = 1 << 16;
+
+    explicit ProfileThread(int id) : m_Id{ id } { }
+
+    int GetId() const { return m_Id; }
+
+    // Null until the thread is named
+    const char* GetName() const { return m_Name.load(std::memory_order_acquire); }
+    void SetName(const char* name) { m_Name.store(name, std::memory_order_release); }
+
+    // Called by the owning thread only
+    void Record(const ProfileEvent& event) {
+        const std::uint64_t position = m_Written.load(std::memory_order_relaxed);
+
+        m_Events[position % Capacity] = event;
+        m_Written.store(position + 1, std::memory_order_release);
+    }
+
+    // Events written so far, ever increasing
+    std::uint64_t GetWrittenCount() const { return m_Written.load(std::memory_order_acquire); }
+
+    // Appends the events from position since onwards that are still in the buffer and returns the
+    // position to continue from
+    std::uint64_t Read(std::uint64_t since, std::vector<ProfileEvent>& events) const;
+
+    // Opens the hardware counters of the owning thread the first time it is called, false if they
+    // could not be opened. Called by the owning thread only.
+    bool OpenCounters() {
+        if (!m_CountersTried) {
+            m_CountersTried = true;
+            m_Counters.Open();
+        }
+
+        return m_Counters.IsOpen();
+    }
+
+    const PerfCounters& GetCounters() const { return m_Counters; }
+
+    int depth{ 0 };
+
+private:
+    int m_Id;
+    std::atomic<const char*> m_Name{ nullptr };
+
+    std::array<ProfileEvent, Capacity> m_Events{ };
+    std::atomic<std::uint64_t> m_Written{ 0 };
+
+    PerfCounters m_Counters;
+    bool m_CountersTried{ false };
+};
+
+namespace Profiler {
+    inline std::atomic<bool> enabled{ false };
+
+    // Scopes also read the hardware counters while the profiler is enabled, see PerfCounters
+    inline std::atomic<bool> countersEnabled{ false };
+
+    // Time stamp counter, far cheaper to read than the steady clock
+    inline std::uint64_t Now() {
+        return __rdtsc();
+    }
+
+    // Rate of the time stamp counter, measured against the steady clock on the first call, which
+    // takes a few milliseconds
+    double NanosecondsPerTick();
+
+    // Nanoseconds on the steady clock at the given tick
+    std::uint64_t ToNanoseconds(std::uint64_t ticks);
+
+    inline std::uint64_t SteadyNanoseconds() {
+        return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Buffer of the calling thread, registered on first use
+    ProfileThread& ThisThread();
+
+    // Names the calling thread in the profiler's views, name must outlive the profiler
+    void SetThreadName(const char* name);
+
+    // Every thread that has recorded or been named so far, in registration order. Threads are
+    // never unregistered, so the pointers stay valid.
+    std::vector<ProfileThread*> Threads();
+}
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) {
+        if (!Profiler::enabled.load(std::memory_order_relaxed)) return;
+
+        m_Thread = &Profiler::ThisThread();
+        m_Name = name;
+        m_Depth = m_Thread->depth++;
+
+        m_Counted = Profiler::countersEnabled.load(std::memory_order_relaxed) && m_Thread->OpenCounters();
+        if (m_Counted) m_Counted = m_Thread->GetCounters().Read(m_Counts);
+
+        m_Begin = Profiler::Now();
+    }
+
+    ~ProfileScope() {
+        End();
+    }
+
+    // Ends the scope before it goes out of scope, for spans that do not fit a block
+    void End() {
+        if (!m_Thread) return;
+
+        ProfileEvent event{ m_Name, m_Begin, Profiler::Now(), m_Depth, m_Counted, { } };
+
+        // A failed read leaves the event uncounted rather than with a bogus difference
+        PerfValues counts{ };
+
+        if (m_Counted && m_Thread->GetCounters().Read(counts)) {
+            for (int i = 0; i < PerfCounterCount; ++i) {
+                // Scaled counts of a multiplexed group can step back slightly
+                event.counts[i] = counts[i] > m_Counts[i] ? counts[i] - m_Counts[i] : 0;
+            }
+        }
+        else {
+            event.counted = false;
+        }
+
+        m_Thread->Record(event);
+        --m_Thread->depth;
+
+        m_Thread = nullptr;
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileThread* m_Thread{ nullptr };
+    const char* m_Name{ nullptr };
+    std::uint64_t m_Begin{ 0 };
+    int m_Depth{ 0 };
+
+    bool m_Counted{ false };
+    PerfValues m_Counts{ };
+};
+
+// Duration statistics of the events of one name
+struct ProfileStatistics {
+    const char* name;
+    int depth;
+    int count;
+
+    // Microseconds
+    double minimum;
+    double average;
+    double p99;
+    double maximum;
+
+    // Calls that read the hardware counters, and the average counts of those calls
+    int countedCount;
+    std::array<double, PerfCounterCount> counts;
+};
+
+// Statistics of every name among the events, in order of first appearance
+std::vector<ProfileStatistics> ComputeProfileStatistics(const std::vector<ProfileEvent>& events);
+
+// Calls, time and hardware counts of one name summed over a run, for runs too long to keep every
+// event of
+struct ProfileTotal {
+    const char* name;
+    int depth;
+
+    std::uint64_t count;
+    std::uint64_t ticks;
+
+    std::uint64_t countedCount;
+    PerfValues counts;
+};
+
+// Adds the events to the totals of their names, names not seen before are appended
+void AccumulateProfileTotals(const std::vector<ProfileEvent>& events, std::vector<ProfileTotal>& totals);
+
+// The events of every thread over the last few seconds, for the views to draw from. Update reads
+// whatever each thread has recorded since the last call.
+class ProfileHistory {
+public:
+    struct Thread {
+        ProfileThread* thread;
+        std::uint64_t readPosition;
+
+        // In the order the scopes ended, so children come before their parents
+        std::vector<ProfileEvent> events;
+    };
+
+    // Seconds of events kept
+    double length{ 2.0 };
+
+    // Per thread, the oldest are dropped early when a thread records faster than this
+    int maxEventCount{ 1 << 20 };
+
+    void Update();
+    void Clear();
+
+    const std::vector<Thread>& GetThreads() const { return m_Threads; }
+
+    // Tick of the newest event seen
+    std::uint64_t GetLatestTick() const { return m_LatestTick; }
+
+private:
+    std::vector<Thread> m_Threads;
+    std::uint64_t m_LatestTick{ 0 };
+};
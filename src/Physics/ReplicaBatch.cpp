@@ -0,0 +1,69 @@
+#include "ReplicaBatch.h"
+
+void ReplicaBatch::Load(const Particles* const* replicas, int count, SimdLevel level) {
+    const Particles& first = *replicas[0];
+    const int particleCount = first.Size();
+
+    m_LaneCount = ReplicaLaneCount(level);
+    m_ReplicaCount = count;
+    m_ChargedEnd = first.ChargedEnd();
+    m_NucleonBegin = first.NucleonBegin();
+    m_Step = GetReplicaStepKernel(level);
+
+    m_Positions.Assign(particleCount * m_LaneCount);
+    m_Velocities.Assign(particleCount * m_LaneCount);
+    m_Forces.Assign(particleCount * m_LaneCount);
+
+    m_InverseMass.assign(first.inverseMass.begin(), first.inverseMass.end());
+    m_Charge.assign(first.charge.begin(), first.charge.end());
+
+    for (int lane = 0; lane < m_LaneCount; ++lane) {
+        const Particles& replica = *replicas[lane < count ? lane : 0];
+
+        for (int p = 0; p < particleCount; ++p) {
+            const int slot = p * m_LaneCount + lane;
+
+            m_Positions.Set(slot, replica.Position(p));
+            m_Velocities.Set(slot, replica.Velocity(p));
+        }
+    }
+
+    GetReplicaForceKernel(level)(Lanes());
+}
+
+void ReplicaBatch::Step(float dt, int stepCount) {
+    m_Step(Lanes(), dt, stepCount);
+}
+
+void ReplicaBatch::Store(int lane, Particles& particles) const {
+    for (int p = 0; p < particles.Size(); ++p) {
+        const int slot = p * m_LaneCount + lane;
+
+        particles.x[p] = m_Positions.x[slot];
+        particles.y[p] = m_Positions.y[slot];
+        particles.z[p] = m_Positions.z[slot];
+
+        particles.vx[p] = m_Velocities.x[slot];
+        particles.vy[p] = m_Velocities.y[slot];
+        particles.vz[p] = m_Velocities.z[slot];
+    }
+}
+
+ReplicaLanes ReplicaBatch::Lanes() {
+    return ReplicaLanes{
+        .x = m_Positions.x.data(),
+        .y = m_Positions.y.data(),
+        .z = m_Positions.z.data(),
+        .vx = m_Velocities.x.data(),
+        .vy = m_Velocities.y.data(),
+        .vz = m_Velocities.z.data(),
+        .fx = m_Forces.x.data(),
+        .fy = m_Forces.y.data(),
+        .fz = m_Forces.z.data(),
+        .inverseMass = m_InverseMass.data(),
+        .charge = m_Charge.data(),
+        .particleCount = (int)m_InverseMass.size(),
+        .chargedEnd = m_ChargedEnd,
+        .nucleonBegin = m_NucleonBegin
+    };
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CpuFeatures.h"
+#include "Particles.h"
+#include "ReplicaKernels.h"
+
+// A register's worth of replicas of one atom stepped together with velocity Verlet and the direct
+// sums, lane k of every register belonging to replica k. See ReplicaKernels.h for the layout.
+class ReplicaBatch {
+public:
+    static constexpr int MaxLaneCount = 16;
+
+    // Lanes the batch has at the given instruction set, the most replicas one Load takes
+    static int LaneCount(SimdLevel level) { return ReplicaLaneCount(level); }
+
+    // Copies count replicas into the lanes and computes their forces. Every replica must have the
+    // species counts of the first; lanes past count repeat the first replica and are never stored.
+    void Load(const Particles* const* replicas, int count, SimdLevel level);
+
+    // Runs stepCount velocity Verlet steps of length dt on every lane
+    void Step(float dt, int stepCount);
+
+    // Writes the positions and velocities of a lane back to its replica
+    void Store(int lane, Particles& particles) const;
+
+    int GetLaneCount() const { return m_LaneCount; }
+    int GetReplicaCount() const { return m_ReplicaCount; }
+
+private:
+    ReplicaLanes Lanes();
+
+    Vec3Array m_Positions;
+    Vec3Array m_Velocities;
+    Vec3Array m_Forces;
+    AlignedVector<float> m_InverseMass;
+    AlignedVector<float> m_Charge;
+
+    int m_LaneCount{ 1 };
+    int m_ReplicaCount{ 0 };
+    int m_ChargedEnd{ 0 };
+    int m_NucleonBegin{ 0 };
+
+    ReplicaStepKernel m_Step{ nullptr };
+};
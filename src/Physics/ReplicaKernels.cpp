@@ -0,0 +1,101 @@
+#include "ReplicaKernels.h"
+
+#include <glm/glm.hpp>
+
+void ReplicaForcesScalar(const ReplicaLanes& lanes) {
+    for (int p = 0; p < lanes.particleCount; ++p) {
+        lanes.fx[p] = 0.0f;
+        lanes.fy[p] = 0.0f;
+        lanes.fz[p] = 0.0f;
+    }
+
+    for (int i = 0; i < lanes.particleCount; ++i) {
+        for (int j = i + 1; j < lanes.particleCount; ++j) {
+            const bool charged = j < lanes.chargedEnd;
+            const bool nucleons = i >= lanes.nucleonBegin;
+
+            if (!charged && !nucleons) continue;
+
+            float dx = lanes.x[i] - lanes.x[j];
+            float dy = lanes.y[i] - lanes.y[j];
+            float dz = lanes.z[i] - lanes.z[j];
+
+            float distanceSquared = dx * dx + dy * dy + dz * dz;
+            float distance = glm::sqrt(distanceSquared);
+            float inverseDistance = 1.0f / distance;
+
+            float magnitude = 0.0f;
+
+            if (charged) magnitude += lanes.charge[i] * lanes.charge[j] * inverseDistance * inverseDistance;
+
+            if (nucleons) {
+                // Same force as NuclearRowScalar: 1 / r^10 - (e^r / r^2 + e^r / r)
+                float exponential = glm::exp(distance);
+                float distance10 = distanceSquared * distanceSquared * distanceSquared * distanceSquared * distanceSquared;
+
+                magnitude += 1.0f / distance10 - (exponential * inverseDistance * inverseDistance + exponential * inverseDistance);
+            }
+
+            float scale = magnitude * inverseDistance;
+
+            lanes.fx[i] += scale * dx;
+            lanes.fy[i] += scale * dy;
+            lanes.fz[i] += scale * dz;
+
+            lanes.fx[j] -= scale * dx;
+            lanes.fy[j] -= scale * dy;
+            lanes.fz[j] -= scale * dz;
+        }
+    }
+}
+
+void StepReplicasScalar(const ReplicaLanes& lanes, float dt, int stepCount) {
+    const float halfDt = 0.5f * dt;
+
+    for (int step = 0; step < stepCount; ++step) {
+        for (int p = 0; p < lanes.particleCount; ++p) {
+            lanes.vx[p] += lanes.fx[p] * lanes.inverseMass[p] * halfDt;
+            lanes.vy[p] += lanes.fy[p] * lanes.inverseMass[p] * halfDt;
+            lanes.vz[p] += lanes.fz[p] * lanes.inverseMass[p] * halfDt;
+
+            lanes.x[p] += lanes.vx[p] * dt;
+            lanes.y[p] += lanes.vy[p] * dt;
+            lanes.z[p] += lanes.vz[p] * dt;
+        }
+
+        ReplicaForcesScalar(lanes);
+
+        for (int p = 0; p < lanes.particleCount; ++p) {
+            lanes.vx[p] += lanes.fx[p] * lanes.inverseMass[p] * halfDt;
+            lanes.vy[p] += lanes.fy[p] * lanes.inverseMass[p] * halfDt;
+            lanes.vz[p] += lanes.fz[p] * lanes.inverseMass[p] * halfDt;
+        }
+    }
+}
+
+int ReplicaLaneCount(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return 4;
+        case SimdLevel::Avx2: return 8;
+        case SimdLevel::Avx512: return 16;
+        default: return 1;
+    }
+}
+
+ReplicaForceKernel GetReplicaForceKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return ReplicaForcesSse4;
+        case SimdLevel::Avx2: return ReplicaForcesAvx2;
+        case SimdLevel::Avx512: return ReplicaForcesAvx512;
+        default: return ReplicaForcesScalar;
+    }
+}
+
+ReplicaStepKernel GetReplicaStepKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse4: return StepReplicasSse4;
+        case SimdLevel::Avx2: return StepReplicasAvx2;
+        case SimdLevel::Avx512: return StepReplicasAvx512;
+        default: return StepReplicasScalar;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CpuFeatures.h"
+
+// Replicas of one atom laid out lane by lane: component c of particle p in replica k is
+// c[p * lanes + k], so loading particle p fills a vector register with that particle in every
+// replica. All replicas share the species layout, so masses and charges are stored once per
+// particle. The kernels run a whole register of replicas per instruction, which suits atoms too
+// small for the pair loops of a single atom to fill a register.
+struct ReplicaLanes {
+    float* x;
+    float* y;
+    float* z;
+    float* vx;
+    float* vy;
+    float* vz;
+    float* fx;
+    float* fy;
+    float* fz;
+
+    const float* inverseMass;
+    const float* charge;
+
+    int particleCount;
+    int chargedEnd;
+    int nucleonBegin;
+};
+
+using ReplicaForceKernel = void(*)(const ReplicaLanes& lanes);
+using ReplicaStepKernel = void(*)(const ReplicaLanes& lanes, float dt, int stepCount);
+
+// Replicas per register for the given instruction set, the lane count the kernels expect
+int ReplicaLaneCount(SimdLevel level);
+
+// Direct Coulomb and nuclear forces of every replica in an open box
+ReplicaForceKernel GetReplicaForceKernel(SimdLevel level);
+
+// stepCount velocity Verlet steps of every replica, the forces must be current on entry and are
+// current again on return
+ReplicaStepKernel GetReplicaStepKernel(SimdLevel level);
+
+// Per instruction set implementations, compiled alongside the pair kernels for the same set
+void ReplicaForcesSse4(const ReplicaLanes& lanes);
+void StepReplicasSse4(const ReplicaLanes& lanes, float dt, int stepCount);
+
+void ReplicaForcesAvx2(const ReplicaLanes& lanes);
+void StepReplicasAvx2(const ReplicaLanes& lanes, float dt, int stepCount);
+
+void ReplicaForcesAvx512(const ReplicaLanes& lanes);
+void StepReplicasAvx512(const ReplicaLanes& lanes, float dt, int stepCount);
+
+// One replica per "register"
+void ReplicaForcesScalar(const ReplicaLanes& lanes);
+void StepReplicasScalar(const ReplicaLanes& lanes, float dt, int stepCount);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PairKernelsSimd.h"
+#include "ReplicaKernels.h"
+
+// Shared bodies of the replica kernels, V::width replicas per register. See PairKernelsSimd.h for V.
+
+template<typename V>
+void ReplicaForcesSimd(const ReplicaLanes& lanes) {
+    using T = typename V::Type;
+    constexpr int width = V::width;
+
+    for (int p = 0; p < lanes.particleCount; ++p) {
+        V::Store(lanes.fx + p * width, V::Zero());
+        V::Store(lanes.fy + p * width, V::Zero());
+        V::Store(lanes.fz + p * width, V::Zero());
+    }
+
+    // Coulomb q_i * q_j / r^2, each pair once with the reaction on j
+    for (int i = 0; i < lanes.chargedEnd; ++i) {
+        const T xi = V::Load(lanes.x + i * width);
+        const T yi = V::Load(lanes.y + i * width);
+        const T zi = V::Load(lanes.z + i * width);
+
+        T forceX = V::Load(lanes.fx + i * width);
+        T forceY = V::Load(lanes.fy + i * width);
+        T forceZ = V::Load(lanes.fz + i * width);
+
+        for (int j = i + 1; j < lanes.chargedEnd; ++j) {
+            T dx = V::Sub(xi, V::Load(lanes.x + j * width));
+            T dy = V::Sub(yi, V::Load(lanes.y + j * width));
+            T dz = V::Sub(zi, V::Load(lanes.z + j * width));
+
+            T distanceSquared = V::Fma(dz, dz, V::Fma(dy, dy, V::Mul(dx, dx)));
+            T inverseDistance = InverseSqrtSimd<V>(distanceSquared);
+
+            T scale = V::Mul(V::Set(lanes.charge[i] * lanes.charge[j]), V::Mul(V::Mul(inverseDistance, inverseDistance), inverseDistance));
+
+            forceX = V::Fma(scale, dx, forceX);
+            forceY = V::Fma(scale, dy, forceY);
+            forceZ = V::Fma(scale, dz, forceZ);
+
+            V::Store(lanes.fx + j * width, V::Sub(V::Load(lanes.fx + j * width), V::Mul(scale, dx)));
+            V::Store(lanes.fy + j * width, V::Sub(V::Load(lanes.fy + j * width), V::Mul(scale, dy)));
+            V::Store(lanes.fz + j * width, V::Sub(V::Load(lanes.fz + j * width), V::Mul(scale, dz)));
+        }
+
+        V::Store(lanes.fx + i * width, forceX);
+        V::Store(lanes.fy + i * width, forceY);
+        V::Store(lanes.fz + i * width, forceZ);
+    }
+
+    // Nuclear force of the pair kernels, in an open box without a cutoff
+    PairRow openBox{ };
+
+    for (int i = lanes.nucleonBegin; i < lanes.particleCount; ++i) {
+        const T xi = V::Load(lanes.x + i * width);
+        const T yi = V::Load(lanes.y + i * width);
+        const T zi = V::Load(lanes.z + i * width);
+
+        T forceX = V::Load(lanes.fx + i * width);
+        T forceY = V::Load(lanes.fy + i * width);
+        T forceZ = V::Load(lanes.fz + i * width);
+
+        for (int j = i + 1; j < lanes.particleCount; ++j) {
+            T dx = V::Sub(xi, V::Load(lanes.x + j * width));
+            T dy = V::Sub(yi, V::Load(lanes.y + j * width));
+            T dz = V::Sub(zi, V::Load(lanes.z + j * width));
+
+            T scale = NuclearScaleSimd<V>(openBox, dx, dy, dz);
+
+            forceX = V::Fma(scale, dx, forceX);
+            forceY = V::Fma(scale, dy, forceY);
+            forceZ = V::Fma(scale, dz, forceZ);
+
+            V::Store(lanes.fx + j * width, V::Sub(V::Load(lanes.fx + j * width), V::Mul(scale, dx)));
+            V::Store(lanes.fy + j * width, V::Sub(V::Load(lanes.fy + j * width), V::Mul(scale, dy)));
+            V::Store(lanes.fz + j * width, V::Sub(V::Load(lanes.fz + j * width), V::Mul(scale, dz)));
+        }
+
+        V::Store(lanes.fx + i * width, forceX);
+        V::Store(lanes.fy + i * width, forceY);
+        V::Store(lanes.fz + i * width, forceZ);
+    }
+}
+
+// v += F / m * dt for every particle of every replica
+template<typename V>
+void KickReplicasSimd(const ReplicaLanes& lanes, float dt) {
+    using T = typename V::Type;
+    constexpr int width = V::width;
+
+    for (int p = 0; p < lanes.particleCount; ++p) {
+        const T kick = V::Set(lanes.inverseMass[p] * dt);
+
+        V::Store(lanes.vx + p * width, V::Fma(V::Load(lanes.fx + p * width), kick, V::Load(lanes.vx + p * width)));
+        V::Store(lanes.vy + p * width, V::Fma(V::Load(lanes.fy + p * width), kick, V::Load(lanes.vy + p * width)));
+        V::Store(lanes.vz + p * width, V::Fma(V::Load(lanes.fz + p * width), kick, V::Load(lanes.vz + p * width)));
+    }
+}
+
+template<typename V>
+void StepReplicasSimd(const ReplicaLanes& lanes, float dt, int stepCount) {
+    using T = typename V::Type;
+    constexpr int width = V::width;
+
+    const T drift = V::Set(dt);
+
+    for (int step = 0; step < stepCount; ++step) {
+        KickReplicasSimd<V>(lanes, 0.5f * dt);
+
+        for (int p = 0; p < lanes.particleCount; ++p) {
+            V::Store(lanes.x + p * width, V::Fma(V::Load(lanes.vx + p * width), drift, V::Load(lanes.x + p * width)));
+            V::Store(lanes.y + p * width, V::Fma(V::Load(lanes.vy + p * width), drift, V::Load(lanes.y + p * width)));
+            V::Store(lanes.z + p * width, V::Fma(V::Load(lanes.vz + p * width), drift, V::Load(lanes.z + p * width)));
+        }
+
+        ReplicaForcesSimd<V>(lanes);
+
+        KickReplicasSimd<V>(lanes, 0.5f * dt);
+    }
+}
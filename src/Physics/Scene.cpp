@@ -0,0 +1,67 @@
+#include "Scene.h"
+
+int LatticeSize(int max) {
+    float s = glm::pow((float)max, 1.0f / 3.0f);
+    return (int)glm::ceil(s);
+}
+
+namespace {
+    void AddSpecies(Particles& particles, Species species, const glm::vec3& position, const glm::vec3& velocity) {
+        switch (species) {
+            case Species::Electron: particles.Add(Species::Electron, 0.1f, -1.0f, position, velocity); break;
+            case Species::Proton: particles.Add(Species::Proton, 200.0f, 1.0f, position, velocity); break;
+            case Species::Neutron: particles.Add(Species::Neutron, 200.0f, 0.0f, position, velocity); break;
+        }
+    }
+
+    glm::vec3 NextPosition(int index, int max) {
+        int size = LatticeSize(max);
+
+        int x = index / (size * size);
+        int y = (index / size) % size;
+        int z = index % size;
+
+        return glm::vec3{ (float)x, (float)y, (float)z };
+    }
+}
+
+void AddToState(PhysicsState& state, int neutronCount, int protonCount, int electronCount) {
+    Particles& particles = state.particles;
+
+    int max = neutronCount + protonCount + electronCount;
+    int j = 0;
+
+    int neutronLeft = neutronCount;
+    int protonLeft = protonCount;
+    int electronLeft = electronCount;
+
+    particles.Reserve(particles.Size() + max);
+
+    while (neutronLeft != 0 || protonLeft != 0 || electronLeft != 0) {
+        if (neutronLeft > 0) {
+            AddSpecies(particles, Species::Neutron, NextPosition(j, max), glm::vec3{ 0.0f });
+            ++j;
+            --neutronLeft;
+        }
+
+        if (protonLeft > 0) {
+            AddSpecies(particles, Species::Proton, NextPosition(j, max), glm::vec3{ 0.0f });
+            ++j;
+            --protonLeft;
+        }
+
+        if (electronLeft > 0) {
+            AddSpecies(particles, Species::Electron, NextPosition(j, max), glm::vec3{ 0.0f });
+            ++j;
+            --electronLeft;
+        }
+    }
+
+    particles.GroupBySpecies();
+}
+
+void AddParticle(PhysicsState& state, Species species, const glm::vec3& position, const glm::vec3& velocity) {
+    AddSpecies(state.particles, species, position, velocity);
+
+    state.particles.GroupBySpecies();
+}
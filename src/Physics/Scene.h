@@ -0,0 +1,12 @@
+#pragma once
+
+#include "PhysicsState.h"
+
+// Side length of the cubic lattice the scene builder places particles on
+int LatticeSize(int max);
+
+// Places the particles on a cubic lattice with unit spacing, interleaving the species
+void AddToState(PhysicsState& state, int neutronCount, int protonCount, int electronCount);
+
+// Adds a single particle with the same mass and charge as the scene builder gives its species
+void AddParticle(PhysicsState& state, Species species, const glm::vec3& position, const glm::vec3& velocity);
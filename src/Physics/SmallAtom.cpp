@@ -0,0 +1,242 @@
+#include "SmallAtom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace {
+    // Group capacities, fine grained so little work is wasted on padding
+    constexpr std::array<int, 6> capacities{ 1, 2, 4, 8, 12, 16 };
+    constexpr int CapacityCount = (int)capacities.size();
+
+    // Smallest capacity that holds count, as an index into capacities
+    int CapacityIndex(int count) {
+        int index = 0;
+        while (capacities[index] < count) ++index;
+        return index;
+    }
+
+    // Scalar copy of ExpSimd, inlined where std::exp would be a library call per pair
+    inline float Exp(float x) {
+        x = std::min(std::max(x, -87.3365447505f), 88.3762626647949f);
+
+        float n = std::nearbyint(x * 1.44269504088896341f);
+
+        float r = n * -0.693359375f + x;
+        r = n * 2.12194440e-4f + r;
+
+        float p = 1.9875691500e-4f;
+        p = p * r + 1.3981999507e-3f;
+        p = p * r + 8.3334519073e-3f;
+        p = p * r + 4.1665795894e-2f;
+        p = p * r + 1.6666665459e-1f;
+        p = p * r + 5.0000001201e-1f;
+
+        float y = p * r * r + (r + 1.0f);
+
+        // 2^n through the exponent bits
+        std::uint32_t bits = (std::uint32_t)((int)n + 127) << 23;
+
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+
+        return y * scale;
+    }
+
+    template<int Charged, int Nucleons>
+    void ComputeForces(SmallAtom::Data& data) {
+        float* fx = data.fx.data();
+        float* fy = data.fy.data();
+        float* fz = data.fz.data();
+
+        // The groups overlap by the protons, so every slot in use is below Charged + Nucleons
+        for (int i = 0; i < Charged + Nucleons; ++i) {
+            fx[i] = 0.0f;
+            fy[i] = 0.0f;
+            fz[i] = 0.0f;
+        }
+
+        // Coulomb q_i * q_j / r^2 over the charged slots, padding has no charge
+        for (int i = 0; i < Charged; ++i) {
+            for (int j = i + 1; j < Charged; ++j) {
+                float dx = data.x[i] - data.x[j];
+                float dy = data.y[i] - data.y[j];
+                float dz = data.z[i] - data.z[j];
+
+                float inverseDistance = 1.0f / std::sqrt(dx * dx + dy * dy + dz * dz);
+                float scale = data.charge[i] * data.charge[j] * inverseDistance * inverseDistance * inverseDistance;
+
+                fx[i] += scale * dx;
+                fy[i] += scale * dy;
+                fz[i] += scale * dz;
+
+                fx[j] -= scale * dx;
+                fy[j] -= scale * dy;
+                fz[j] -= scale * dz;
+            }
+        }
+
+        // Same force as the nuclear pair kernels, F(r) = 1 / r^10 - (e^r / r^2 + e^r / r)
+        const int begin = data.nucleonBegin;
+
+        for (int a = 0; a < Nucleons; ++a) {
+            for (int b = a + 1; b < Nucleons; ++b) {
+                const int i = begin + a;
+                const int j = begin + b;
+
+                float dx = data.x[i] - data.x[j];
+                float dy = data.y[i] - data.y[j];
+                float dz = data.z[i] - data.z[j];
+
+                float distanceSquared = dx * dx + dy * dy + dz * dz;
+                float distance = std::sqrt(distanceSquared);
+                float inverseDistance = 1.0f / distance;
+
+                float exponential = Exp(distance);
+                float distance10 = distanceSquared * distanceSquared * distanceSquared * distanceSquared * distanceSquared;
+
+                float magnitude = 1.0f / distance10 - (exponential * inverseDistance * inverseDistance + exponential * inverseDistance);
+
+                // Padding is far away, where e^r overflows, so select rather than multiply by the mask
+                float scale = data.nucleon[i] * data.nucleon[j] > 0.0f ? magnitude * inverseDistance : 0.0f;
+
+                fx[i] += scale * dx;
+                fy[i] += scale * dy;
+                fz[i] += scale * dz;
+
+                fx[j] -= scale * dx;
+                fy[j] -= scale * dy;
+                fz[j] -= scale * dz;
+            }
+        }
+    }
+
+    template<int Charged, int Nucleons>
+    void Step(SmallAtom::Data& data, float dt, int stepCount) {
+        // Padding has zero inverse mass, so stepping it leaves it in place
+        constexpr int Slots = Charged + Nucleons;
+        const float halfDt = 0.5f * dt;
+
+        for (int step = 0; step < stepCount; ++step) {
+            for (int i = 0; i < Slots; ++i) {
+                data.vx[i] += data.fx[i] * data.inverseMass[i] * halfDt;
+                data.vy[i] += data.fy[i] * data.inverseMass[i] * halfDt;
+                data.vz[i] += data.fz[i] * data.inverseMass[i] * halfDt;
+
+                data.x[i] += data.vx[i] * dt;
+                data.y[i] += data.vy[i] * dt;
+                data.z[i] += data.vz[i] * dt;
+            }
+
+            ComputeForces<Charged, Nucleons>(data);
+
+            for (int i = 0; i < Slots; ++i) {
+                data.vx[i] += data.fx[i] * data.inverseMass[i] * halfDt;
+                data.vy[i] += data.fy[i] * data.inverseMass[i] * halfDt;
+                data.vz[i] += data.fz[i] * data.inverseMass[i] * halfDt;
+            }
+        }
+    }
+
+    using StepFunction = void(*)(SmallAtom::Data&, float, int);
+    using ForceFunction = void(*)(SmallAtom::Data&);
+
+    // Every combination of charged and nucleon capacity, indexed [charged * CapacityCount + nucleon]
+    template<int... Indices>
+    constexpr std::array<StepFunction, sizeof...(Indices)> MakeStepTable(std::integer_sequence<int, Indices...>) {
+        return { &Step<capacities[Indices / CapacityCount], capacities[Indices % CapacityCount]>... };
+    }
+
+    template<int... Indices>
+    constexpr std::array<ForceFunction, sizeof...(Indices)> MakeForceTable(std::integer_sequence<int, Indices...>) {
+        return { &ComputeForces<capacities[Indices / CapacityCount], capacities[Indices % CapacityCount]>... };
+    }
+
+    constexpr auto stepTable = MakeStepTable(std::make_integer_sequence<int, CapacityCount * CapacityCount>{ });
+    constexpr auto forceTable = MakeForceTable(std::make_integer_sequence<int, CapacityCount * CapacityCount>{ });
+}
+
+bool SmallAtom::Load(const Particles& particles) {
+    const int electrons = particles.Count(Species::Electron);
+    const int protons = particles.Count(Species::Proton);
+    const int neutrons = particles.Count(Species::Neutron);
+
+    if (electrons + protons > MaxGroupSize || protons + neutrons > MaxGroupSize) return false;
+
+    const int chargedIndex = CapacityIndex(electrons + protons);
+    const int nucleonIndex = CapacityIndex(protons + neutrons);
+
+    Data& data = m_Data;
+
+    data.chargedCapacity = capacities[chargedIndex];
+    data.nucleonCapacity = capacities[nucleonIndex];
+
+    // Electrons, charge padding, then the protons at the end of the charged group, which the
+    // nucleon group starts with, followed by the neutrons and the nucleon padding
+    data.nucleonBegin = data.chargedCapacity - protons;
+
+    for (int slot = 0; slot < Data::SlotCount; ++slot) {
+        // Spread far apart and far from the atom so no distance is ever zero
+        data.x[slot] = 1.0e6f + 1.0e3f * slot;
+        data.y[slot] = 1.0e6f;
+        data.z[slot] = 1.0e6f;
+
+        data.vx[slot] = 0.0f;
+        data.vy[slot] = 0.0f;
+        data.vz[slot] = 0.0f;
+
+        data.inverseMass[slot] = 0.0f;
+        data.charge[slot] = 0.0f;
+        data.nucleon[slot] = 0.0f;
+        data.particle[slot] = -1;
+    }
+
+    auto place = [&](int slot, int i) {
+        data.x[slot] = particles.x[i];
+        data.y[slot] = particles.y[i];
+        data.z[slot] = particles.z[i];
+
+        data.vx[slot] = particles.vx[i];
+        data.vy[slot] = particles.vy[i];
+        data.vz[slot] = particles.vz[i];
+
+        data.inverseMass[slot] = particles.inverseMass[i];
+        data.charge[slot] = particles.charge[i];
+        data.nucleon[slot] = particles.species[i] == Species::Electron ? 0.0f : 1.0f;
+        data.particle[slot] = i;
+    };
+
+    for (int i = 0; i < electrons; ++i) {
+        place(i, i);
+    }
+
+    for (int i = electrons; i < particles.Size(); ++i) {
+        place(data.nucleonBegin + i - electrons, i);
+    }
+
+    m_Step = stepTable[chargedIndex * CapacityCount + nucleonIndex];
+    forceTable[chargedIndex * CapacityCount + nucleonIndex](data);
+
+    return true;
+}
+
+void SmallAtom::Step(float dt, int stepCount) {
+    m_Step(m_Data, dt, stepCount);
+}
+
+void SmallAtom::Store(Particles& particles) const {
+    for (int slot = 0; slot < Data::SlotCount; ++slot) {
+        const int i = m_Data.particle[slot];
+        if (i < 0) continue;
+
+        particles.x[i] = m_Data.x[slot];
+        particles.y[i] = m_Data.y[slot];
+        particles.z[i] = m_Data.z[slot];
+
+        particles.vx[i] = m_Data.vx[slot];
+        particles.vy[i] = m_Data.vy[slot];
+        particles.vz[i] = m_Data.vz[slot];
+    }
+}
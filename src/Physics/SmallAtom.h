@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+
+#include "Particles.h"
+
+// Fast path for atoms of at most 16 charged particles and 16 nucleons, stepped with velocity
+// Verlet and the direct Coulomb and nuclear sums. Past that the SIMD kernels of the general path
+// win over the scalar loops here.
+//
+// The particles are copied into fixed size arrays and the pair loops are compiled separately for
+// every capacity of the charged and the nucleon group, so the loop bounds are
+// constants the compiler unrolls and keeps in registers. The padding slots have no charge, are
+// masked out of the nuclear force and sit far away, so they never feel or exert a force. Run many
+// steps per call, the whole point is to avoid the per step overhead of the general path.
+class SmallAtom {
+public:
+    static constexpr int MaxGroupSize = 16;
+
+    // Copies the particles in and computes their forces, false if they do not fit
+    bool Load(const Particles& particles);
+
+    // Runs stepCount velocity Verlet steps of length dt
+    void Step(float dt, int stepCount);
+
+    // Writes positions and velocities back to the particles given to Load
+    void Store(Particles& particles) const;
+
+    int GetChargedCapacity() const { return m_Data.chargedCapacity; }
+    int GetNucleonCapacity() const { return m_Data.nucleonCapacity; }
+
+    struct Data {
+        static constexpr int SlotCount = 2 * MaxGroupSize;
+
+        alignas(64) std::array<float, SlotCount> x;
+        alignas(64) std::array<float, SlotCount> y;
+        alignas(64) std::array<float, SlotCount> z;
+        alignas(64) std::array<float, SlotCount> vx;
+        alignas(64) std::array<float, SlotCount> vy;
+        alignas(64) std::array<float, SlotCount> vz;
+        alignas(64) std::array<float, SlotCount> fx;
+        alignas(64) std::array<float, SlotCount> fy;
+        alignas(64) std::array<float, SlotCount> fz;
+        alignas(64) std::array<float, SlotCount> inverseMass;
+        alignas(64) std::array<float, SlotCount> charge;
+
+        // 1 for real nucleons, 0 for the padding of the nucleon group
+        alignas(64) std::array<float, SlotCount> nucleon;
+
+        // Particle index of every slot, -1 for padding
+        std::array<int, SlotCount> particle;
+
+        // Charged slots are [0, chargedCapacity), nucleon slots [nucleonBegin, nucleonBegin + nucleonCapacity)
+        int chargedCapacity;
+        int nucleonCapacity;
+        int nucleonBegin;
+    };
+
+private:
+    using StepFunction = void(*)(Data& data, float dt, int stepCount);
+
+    Data m_Data{ };
+    StepFunction m_Step{ nullptr };
+};
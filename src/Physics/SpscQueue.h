@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock free queue between exactly one producer thread and one consumer thread.
+//
+// A ring of Capacity slots with a head index only the consumer advances and a tail index only the
+// producer advances. Each side publishes its index with a release store after touching the slot,
+// and reads the other side's index with an acquire load, so a slot is never read and written at
+// the same time. Neither call blocks, a full or empty queue is reported instead. Slots are moved
+// into and out of, so their storage is reused rather than allocated per item.
+template<typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer only: false, leaving value untouched, if the queue is full
+    bool TryPush(T&& value) {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+
+        if (tail - m_CachedHead == Capacity) {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead == Capacity) return false;
+        }
+
+        m_Slots[tail & (Capacity - 1)] = std::move(value);
+        m_Tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer only: false if the queue is empty
+    bool TryPop(T& value) {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+
+        if (head == m_CachedTail) {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail) return false;
+        }
+
+        value = std::move(m_Slots[head & (Capacity - 1)]);
+        m_Head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> m_Slots{ };
+
+    // Producer side, the cached head saves touching the consumer's cache line on every push
+    alignas(64) std::atomic<size_t> m_Tail{ 0 };
+    size_t m_CachedHead{ 0 };
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> m_Head{ 0 };
+    size_t m_CachedTail{ 0 };
+};
@@ -0,0 +1,170 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#include "AllocationCounter.h"
+
+ThreadPool::ThreadPool(int threadCount, bool countAllocations)
+    : m_CountAllocations(countAllocations) {
+    Start(threadCount);
+}
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+void ThreadPool::Resize(int threadCount) {
+    if (threadCount == GetThreadCount()) return;
+
+    Stop();
+    Start(threadCount);
+}
+
+void ThreadPool::Start(int threadCount) {
+    threadCount = std::max(1, threadCount);
+
+    unsigned long long generation;
+
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_Stopping = false;
+        generation = m_Generation;
+    }
+
+    m_Queues = std::make_unique<Queue[]>(threadCount);
+
+    // The generation carries over from before a Resize, new workers must wait for the next one
+    m_Workers.reserve(threadCount - 1);
+    for (int t = 1; t < threadCount; ++t) {
+        m_Workers.emplace_back([this, t, generation]() {
+            if (m_CountAllocations) CountAllocationsOnThisThread();
+            WorkerLoop(t, generation);
+        });
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+        m_Stopping = true;
+    }
+
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+
+    m_Workers.clear();
+}
+
+void ThreadPool::RunErased(int taskCount, Invoker invoker, void* context) {
+    if (taskCount <= 0) return;
+
+    const int threadCount = GetThreadCount();
+
+    if (threadCount == 1 || taskCount == 1) {
+        for (int task = 0; task < taskCount; ++task) {
+            invoker(context, task, 0);
+        }
+
+        return;
+    }
+
+    for (int t = 0; t < threadCount; ++t) {
+        m_Queues[t].begin = (int)((long long)taskCount * t / threadCount);
+        m_Queues[t].end = (int)((long long)taskCount * (t + 1) / threadCount);
+    }
+
+    m_FinishedWorkers.store(0, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock{ m_Mutex };
+
+        m_Invoker = invoker;
+        m_Context = context;
+        ++m_Generation;
+    }
+
+    m_WakeCondition.notify_all();
+
+    Participate(0);
+
+    // Every worker takes part in every generation, so once all of them are back every task has run
+    const int workerCount = (int)m_Workers.size();
+    while (m_FinishedWorkers.load(std::memory_order_acquire) < workerCount) {
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::WorkerLoop(int threadIndex, unsigned long long seenGeneration) {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{ m_Mutex };
+            m_WakeCondition.wait(lock, [&]() { return m_Stopping || m_Generation != seenGeneration; });
+
+            if (m_Stopping) return;
+
+            seenGeneration = m_Generation;
+        }
+
+        Participate(threadIndex);
+
+        m_FinishedWorkers.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ThreadPool::Participate(int threadIndex) {
+    int task;
+
+    while (true) {
+        while (Pop(threadIndex, task)) {
+            m_Invoker(m_Context, task, threadIndex);
+        }
+
+        if (!Steal(threadIndex)) return;
+    }
+}
+
+bool ThreadPool::Pop(int threadIndex, int& task) {
+    Queue& queue = m_Queues[threadIndex];
+    std::lock_guard<std::mutex> lock{ queue.mutex };
+
+    if (queue.begin == queue.end) return false;
+
+    task = queue.begin++;
+    return true;
+}
+
+bool ThreadPool::Steal(int threadIndex) {
+    const int threadCount = GetThreadCount();
+
+    for (int offset = 1; offset < threadCount; ++offset) {
+        Queue& victim = m_Queues[(threadIndex + offset) % threadCount];
+
+        int begin;
+        int end;
+
+        {
+            std::lock_guard<std::mutex> lock{ victim.mutex };
+
+            int available = victim.end - victim.begin;
+            if (available == 0) continue;
+
+            // Take the back half, rounding up so a single remaining task can be stolen
+            begin = victim.end - (available + 1) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        Queue& own = m_Queues[threadIndex];
+        std::lock_guard<std::mutex> lock{ own.mutex };
+
+        own.begin = begin;
+        own.end = end;
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fork-join pool with per thread work stealing queues.
+//
+// Run hands out task indices [0, taskCount): each thread starts with an equal contiguous block in
+// its own queue, takes tasks from the front, and once it runs dry steals the back half of another
+// thread's queue. The calling thread takes part as thread 0, so a pool of one thread runs
+// everything inline without any synchronisation.
+//
+// With countAllocations set the workers opt into the allocation counter (AllocationCounter.h), for
+// the pool of a loop that is checked to run without allocating. The caller opts in on its own.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount = 1, bool countAllocations = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads taking part in Run, including the caller
+    int GetThreadCount() const { return (int)m_Workers.size() + 1; }
+
+    // Stops the workers and starts threadCount - 1 new ones, must not be called during Run
+    void Resize(int threadCount);
+
+    // Calls task(taskIndex, threadIndex) for every task and returns once all of them have finished
+    template<typename Task>
+    void Run(int taskCount, Task&& task) {
+        using TaskType = std::remove_reference_t<Task>;
+
+        RunErased(taskCount, [](void* context, int taskIndex, int threadIndex) {
+            (*static_cast<TaskType*>(context))(taskIndex, threadIndex);
+        }, (void*)&task);
+    }
+
+private:
+    using Invoker = void(*)(void* context, int taskIndex, int threadIndex);
+
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        int begin{ 0 };
+        int end{ 0 };
+    };
+
+    void Start(int threadCount);
+    void Stop();
+
+    void RunErased(int taskCount, Invoker invoker, void* context);
+    // Waits for generations after seenGeneration and takes part in each
+    void WorkerLoop(int threadIndex, unsigned long long seenGeneration);
+
+    // Runs tasks from the thread's own queue and steals from the others until every queue is empty
+    void Participate(int threadIndex);
+    bool Pop(int threadIndex, int& task);
+    bool Steal(int threadIndex);
+
+    std::vector<std::thread> m_Workers;
+    std::unique_ptr<Queue[]> m_Queues;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    unsigned long long m_Generation{ 0 };
+    bool m_Stopping{ false };
+
+    Invoker m_Invoker{ nullptr };
+    void* m_Context{ nullptr };
+
+    std::atomic<int> m_FinishedWorkers{ 0 };
+
+    bool m_CountAllocations{ false };
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// Lock free hand over of the latest value from one writer thread to one reader thread.
+//
+// Three buffers rotate between the writer, the reader and a spare slot in the middle. The writer
+// fills its buffer and publishes it by swapping it with the middle one, the reader takes the newest
+// value by swapping its own buffer with the middle one. Neither side ever waits for the other, the
+// writer simply overwrites a value the reader has not picked up yet. Buffers are reused, so values
+// that own memory (like vectors) stop allocating once they have grown to size.
+template<typename T>
+class TripleBuffer {
+public:
+    // Writer only: the buffer to fill before the next Publish
+    T& WriteBuffer() { return m_Buffers[m_WriteIndex]; }
+
+    // Writer only: makes the write buffer the newest value and takes another buffer to write to
+    void Publish() {
+        // Release so the reader sees the whole value, acquire so the reader is done with the buffer handed back
+        int previous = m_Middle.exchange(m_WriteIndex | FreshBit, std::memory_order_acq_rel);
+        m_WriteIndex = previous & IndexMask;
+    }
+
+    // Reader only: switches the read buffer to the newest value, false if nothing was published since
+    bool Update() {
+        if (!(m_Middle.load(std::memory_order_relaxed) & FreshBit)) return false;
+
+        int previous = m_Middle.exchange(m_ReadIndex, std::memory_order_acq_rel);
+        m_ReadIndex = previous & IndexMask;
+
+        return true;
+    }
+
+    // Reader only: the value taken by the last Update, stays valid until the next Update
+    const T& ReadBuffer() const { return m_Buffers[m_ReadIndex]; }
+
+private:
+    static constexpr int IndexMask = 3;
+    static constexpr int FreshBit = 4;
+
+    std::array<T, 3> m_Buffers{ };
+
+    // Each index is owned by one thread, kept on separate cache lines so they do not contend
+    alignas(64) int m_WriteIndex{ 0 };
+    alignas(64) std::atomic<int> m_Middle{ 1 };
+    alignas(64) int m_ReadIndex{ 2 };
+};
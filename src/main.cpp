@@ -21,6 +21,35 @@
 #include <utility/Transform.h>
 #include <glm/ext/quaternion_trigonometric.hpp>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "Physics/AllocationCounter.h"
+#include "Physics/BarnesHut.h"
+#include "Physics/BlockTimesteps.h"
+#include "Physics/Coulomb.h"
+#include "Physics/CpuFeatures.h"
+#include "Physics/Ensemble.h"
+#include "Physics/FastMultipole.h"
+#include "Physics/Hermite.h"
+#include "Physics/Integrator.h"
+#include "Physics/KSRegularization.h"
+#include "Physics/Nuclear.h"
+#include "Physics/Parallel.h"
+#include "Physics/ParticleMeshEwald.h"
+#include "Physics/Periodic.h"
+#include "Physics/PhysicsCommand.h"
+#include "Physics/PhysicsSettings.h"
+#include "Physics/PhysicsState.h"
+#include "Physics/ProfileCapture.h"
+#include "Physics/Profiler.h"
+#include "Physics/Scene.h"
+#include "Physics/SmallAtom.h"
+#include "Physics/ThreadPool.h"
+#include "Physics/TripleBuffer.h"
 
 using namespace RenderingUtilities;
 
@@ -30,18 +59,6 @@ struct Rect {
     glm::vec3 color;
 };
 
-struct PointMass {
-    float mass;
-    glm::vec3 position;
-    glm::vec3 velocity;
-};
-
-struct PointCharge : PointMass {
-    float charge;
-};
-
-struct Nucleon : PointCharge { };
-
 void glfwErrorCallback(int error, const char* description) {
     std::cout << "ERROR: GLFW has thrown an error: " << std::endl;
     std::cout << description << std::endl;
@@ -139,64 +156,34 @@ void MoveCamera(Camera& camera, GLFWwindow* window, float dt, const glm::ivec2&
     }
 }
 
-struct PhysicsState {
-    std::vector<PointMass> pointMasses;
-    std::vector<PointCharge> pointCharges;
-    std::vector<Nucleon> nucleons;
-} physicsState;
+PhysicsState physicsState;
 
 struct RenderState {
     std::vector<Rect> rects;
 } renderState;
 
-glm::vec3 NextPosition(int index, int max) {
-    float s = glm::pow(max, 1.0f / 3.0f);
-    int size = (int)glm::ceil(s);
+int main(int argc, char** argv) {
+    // --trace PATH captures the first seconds of the run, --trace-seconds of them, as a Chrome trace
+    std::string traceOutput{ };
+    float traceSeconds = 5.0f;
 
-    int x = index / (size * size);
-    int y = (index / size) % size;
-    int z = index % size;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view option = argv[i];
 
-    return glm::vec3{ (float)x, (float)y, (float)z };
-}
-
-void AddToState(int neutronCount, int protonCount, int electronCount) {
-    int max = neutronCount + protonCount + electronCount;
-    int j = 0;
-
-    int neutronLeft = neutronCount;
-    int protonLeft = protonCount;
-    int electronLeft = electronCount;
-
-    while (neutronLeft != 0 || protonLeft != 0 || electronLeft != 0) {
-        if (neutronLeft > 0) {
-            Nucleon n{ 200.0f, NextPosition(j, max), glm::vec3{ 0.0f }, 0.0f };
-
-            physicsState.nucleons.push_back(n);
-            ++j;
-            --neutronLeft;
+        if (i + 1 >= argc) {
+            std::cout << "ERROR: Missing value for " << option << std::endl;
+            return 1;
         }
 
-        if (protonLeft > 0) {
-            Nucleon p{ 200.0f, NextPosition(j, max), glm::vec3{ 0.0f }, 1.0f };
-
-            physicsState.nucleons.push_back(p);
-            ++j;
-            --protonLeft;
-        }
-
-        if (electronLeft > 0) {
-            PointCharge e{ 0.1f, NextPosition(j, max), glm::vec3{ 0.0f }, -1.0f };
-
-            physicsState.pointCharges.push_back(e);
-            ++j;
-            --electronLeft;
+        if (option == "--trace") traceOutput = argv[++i];
+        else if (option == "--trace-seconds") traceSeconds = (float)std::atof(argv[++i]);
+        else {
+            std::cout << "ERROR: Unknown option " << option << std::endl;
+            return 1;
         }
     }
-}
 
-int main() {
-    AddToState(2, 2, 1);
+    AddToState(physicsState, 2, 2, 1);
 
     glfwSetErrorCallback(glfwErrorCallback);
 
@@ -326,7 +313,6 @@ int main() {
 
     std::chrono::duration<double> frameTime{ };
     std::chrono::duration<double> renderTime{ };
-    std::chrono::duration<double> physicsTime{ };
 
     bool mouseOverViewPort{ false };
     glm::ivec2 viewportOffset{ 0, 0 };
@@ -334,117 +320,540 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     glfwSwapInterval(1);
 
-    const size_t physicsStateQueueSize = 4;
-    std::array<PhysicsState, physicsStateQueueSize> physicsStateQueue;
-    int mostRecentPhysicsState = 0;
+    // Latest state from the physics thread for the renderer
+    TripleBuffer<PhysicsState> publishedPhysicsState{ };
 
     int newSceneProtonCount = 2;
     int newSceneNeutronCount = 2;
     int newSceneElectronCount = 1;
 
-    float timeMultiplier = 1.0f;
+    // Its workers and the physics thread count their heap allocations, see stepAllocations
+    ThreadPool threadPool{ (int)std::thread::hardware_concurrency(), true };
+
+    const SimdLevel supportedSimdLevel = DetectSimdLevel();
+
+    // Solver settings as edited in the UI, published every frame and picked up between two steps
+    PhysicsSettings physicsSettings{ };
+    physicsSettings.simdLevel = supportedSimdLevel;
+    physicsSettings.threadCount = threadPool.GetThreadCount();
+
+    TripleBuffer<PhysicsSettings> publishedPhysicsSettings{ };
+    publishedPhysicsSettings.WriteBuffer() = physicsSettings;
+    publishedPhysicsSettings.Publish();
+
+    bool newScenePeriodic = false;
+    float newSceneBoxSize = 10.0f;
+
+    float timeStep = 1.0f / 1000.0f;
+    float stepsPerSecond = 1000.0f;
+    bool unlimitedStepRate = false;
+
+    // Whether the physics thread is stepping the atom through SmallAtom
+    std::atomic<bool> smallAtomActive{ false };
 
-    float dt = 1.0f / 1000.0f;
+    bool paused = false;
 
-    bool closePhysicsThread = false;
-    bool reloadScene = true;
+    Species newParticleSpecies = Species::Electron;
+    glm::vec3 newParticlePosition{ 0.0f };
+    glm::vec3 newParticleVelocity{ 0.0f };
+    int removeParticleIndex = 0;
+
+    std::atomic<bool> closePhysicsThread{ false };
+
+    // Ensembles run on their own thread and pool, the atom on screen keeps running meanwhile
+    Ensemble ensemble{ };
+    std::thread ensembleThread{ };
+    std::atomic<bool> ensembleRunning{ false };
+    EnsembleStatistics ensembleStatistics{ };
+    bool ensembleFinished = false;
+
+    // Heap allocations made by the physics threads during the last step, 0 once it has warmed up
+    std::atomic<std::uint64_t> stepAllocations{ 0 };
+
+    // The scene and the pacing settings only reach the physics thread through these commands
+    PhysicsCommandQueue physicsCommands{ };
+
+    auto sendCommand = [&](PhysicsCommand&& command) {
+        return physicsCommands.TryPush(std::move(command));
+    };
+
+    sendCommand(PhysicsCommand{ .type = PhysicsCommandType::LoadScene, .scene = physicsState });
+
+    // Settings as last sent, resent whenever the UI values differ, so a full queue only delays them
+    float sentTimeStep = -1.0f;
+    float sentStepsPerSecond = -1.0f;
+    bool sentUnlimitedStepRate = false;
 
     std::thread physicsThread{ [&]() {
-        while (!closePhysicsThread) {
-            TimeScope physicsTimeScope{ &physicsTime };
+        CountAllocationsOnThisThread();
+        Profiler::SetThreadName("Physics");
+
+        // State being integrated, copied into the published buffers after every step
+        PhysicsState state{ };
+
+        // Settings for the current step, only replaced between two steps
+        PhysicsSettings settings{ };
+
+        // The solvers are only ever touched by this thread, the UI sees their statistics through the state
+        BarnesHutTree barnesHutTree{ };
+        FastMultipole fastMultipole{ };
+        ParticleMeshEwald particleMeshEwald{ };
+        NuclearCellList nuclearCellList{ };
+        NuclearNeighbourList nuclearNeighbourList{ };
+        BlockTimesteps blockTimesteps{ };
+        HermiteIntegrator hermiteIntegrator{ };
+        KSRegularization ksRegularization{ };
+
+        ForceAccumulator forceAccumulator{ };
+        Vec3Array coulombField{ };
+        Vec3Array coulombForces{ };
+        Vec3Array nuclearForces{ };
+
+        bool measureCoulombError = false;
+        float coulombError = 0.0f;
+
+        float physicsTimeStep = 0.0f;
+        float physicsStepsPerSecond = 1.0f;
+        bool physicsUnlimitedStepRate = false;
+        bool physicsPaused = false;
+        int singleSteps = 0;
+
+        Vec3Array forces{ };
+        bool forcesValid = false;
+        IntegrationScheme forcesScheme = settings.integrationScheme;
+
+        // Coulomb force on every charged particle at its current position
+        auto computeCoulombForces = [&](const Particles& particles, bool periodic, float boxSize) {
+            ProfileScope profileScope{ "Coulomb" };
+
+            const int chargedEnd = particles.ChargedEnd();
+
+            if (periodic || settings.coulombSolver != CoulombSolver::Direct) {
+                if (periodic) {
+                    particleMeshEwald.cutoff = settings.ewaldCutoff;
+                    particleMeshEwald.meshSize = settings.ewaldMeshSize;
+                    particleMeshEwald.splineOrder = settings.ewaldSplineOrder;
+
+                    particleMeshEwald.Evaluate(particles, 0, chargedEnd, boxSize, threadPool, coulombField);
+                }
+                else if (settings.coulombSolver == CoulombSolver::BarnesHut) {
+                    BarnesHutCoulombField(barnesHutTree, particles, 0, chargedEnd, settings.barnesHutTheta, threadPool, coulombField);
+                }
+                else {
+                    fastMultipole.order = settings.fastMultipoleOrder;
+                    fastMultipole.theta = settings.fastMultipoleTheta;
+                    fastMultipole.leafCapacity = settings.fastMultipoleLeafCapacity;
 
-            if (reloadScene) {
-                for (int i = 0; i < physicsStateQueueSize; ++i) {
-                    physicsStateQueue[i] = PhysicsState{ };
+                    fastMultipole.Evaluate(particles, 0, chargedEnd, threadPool, coulombField);
                 }
 
-                physicsStateQueue[0] = physicsState;
-                mostRecentPhysicsState = 0;
+                if (measureCoulombError && !periodic) {
+                    coulombError = CoulombFieldError(particles, 0, chargedEnd, coulombField, 1000);
+                    measureCoulombError = false;
+                }
+
+                coulombForces.Assign(particles.Size());
 
-                reloadScene = false;
+                for (int i = 0; i < chargedEnd; ++i) {
+                    coulombForces.x[i] = particles.charge[i] * coulombField.x[i];
+                    coulombForces.y[i] = particles.charge[i] * coulombField.y[i];
+                    coulombForces.z[i] = particles.charge[i] * coulombField.z[i];
+                }
             }
+            else {
+                DirectCoulombForces(particles, 0, chargedEnd, forceAccumulator, threadPool, settings.simdLevel, coulombForces);
+            }
+        };
 
-            PhysicsState state = physicsStateQueue[mostRecentPhysicsState];
+        // Strong force on every nucleon at its current position
+        auto computeNuclearForces = [&](const Particles& particles, bool periodic, float boxSize) {
+            ProfileScope profileScope{ "Nuclear" };
 
-            std::vector<PointCharge*> chargedParticles{ };
+            const int nucleonBegin = particles.NucleonBegin();
 
-            for (auto& pc : state.pointCharges) {
-                chargedParticles.push_back(&pc);
-            }
+            if (settings.nuclearSolver == NuclearSolver::CellList) {
+                nuclearCellList.cutoff = settings.nuclearCutoff;
+                nuclearCellList.cellSize = settings.nuclearCellSize;
 
-            for (auto& n : state.nucleons) {
-                if (n.charge == 0.0f) continue;
+                nuclearCellList.Evaluate(particles, nucleonBegin, particles.Size(), periodic, boxSize, forceAccumulator, threadPool, settings.simdLevel, nuclearForces);
+            }
+            else if (settings.nuclearSolver == NuclearSolver::NeighbourList) {
+                nuclearNeighbourList.cutoff = settings.nuclearCutoff;
+                nuclearNeighbourList.skin = settings.nuclearSkin;
 
-                chargedParticles.push_back(&n);
+                nuclearNeighbourList.Evaluate(particles, nucleonBegin, particles.Size(), periodic, boxSize, forceAccumulator, threadPool, settings.simdLevel, nuclearForces);
+            }
+            else {
+                NuclearForces(particles, nucleonBegin, particles.Size(), periodic, boxSize, forceAccumulator, threadPool, settings.simdLevel, nuclearForces);
+            }
+        };
+
+        // Total force on every particle at its current position
+        auto computeForces = [&](const Particles& particles, bool periodic, float boxSize) {
+            computeCoulombForces(particles, periodic, boxSize);
+            computeNuclearForces(particles, periodic, boxSize);
+            SumForces(coulombForces, nuclearForces, particles.Size(), forces);
+        };
+
+        // Total force on the targets only, which are sorted so the charged ones come first. Only the
+        // direct sums can skip the other particles, and only pay off for a minority of them
+        auto computeForcesOn = [&](const Particles& particles, const int* targets, int targetCount, bool periodic, float boxSize) {
+            const bool direct = !periodic && settings.coulombSolver == CoulombSolver::Direct && settings.nuclearSolver == NuclearSolver::Direct;
+
+            if (!direct || 2 * targetCount > particles.Size()) {
+                computeForces(particles, periodic, boxSize);
+                return;
             }
 
-            for (int i = 0; i < chargedParticles.size(); ++i) {
-                for (int j = 0; j < chargedParticles.size(); ++j) {
-                    if (i == j) continue;
+            const int chargedEnd = particles.ChargedEnd();
+            const int nucleonBegin = particles.NucleonBegin();
 
-                    PointCharge& c1 = *chargedParticles[i];
-                    PointCharge& c2 = *chargedParticles[j];
+            const int chargedTargetCount = (int)(std::lower_bound(targets, targets + targetCount, chargedEnd) - targets);
+            const int nucleonTargetBegin = (int)(std::lower_bound(targets, targets + targetCount, nucleonBegin) - targets);
 
-                    float distance = glm::distance(c1.position, c2.position);
+            {
+                ProfileScope profileScope{ "Coulomb" };
+                DirectCoulombForcesOn(particles, 0, chargedEnd, targets, chargedTargetCount, threadPool, settings.simdLevel, coulombForces);
+            }
 
-                    float force = (c1.charge * c2.charge) / (distance * distance);
+            {
+                ProfileScope profileScope{ "Nuclear" };
+                NuclearForcesOn(particles, nucleonBegin, particles.Size(), targets + nucleonTargetBegin, targetCount - nucleonTargetBegin, periodic, boxSize, threadPool, settings.simdLevel, nuclearForces);
+            }
 
-                    glm::vec3 direction = glm::normalize(c1.position - c2.position);
+            for (int t = 0; t < targetCount; ++t) {
+                const int i = targets[t];
 
-                    glm::vec3 accel = (force * direction) / c1.mass;
+                // Entries outside each sum's range are not written, so they may be stale
+                glm::vec3 force{ 0.0f };
+                if (i < chargedEnd) force += coulombForces.Get(i);
+                if (i >= nucleonBegin) force += nuclearForces.Get(i);
 
-                    c1.velocity += accel * dt;
+                forces.Set(i, force);
+            }
+        };
+
+        // Copies the state into the published buffer along with the statistics the UI shows, which
+        // the solvers only keep on this thread
+        auto publishState = [&]() {
+            PhysicsStatistics& statistics = state.statistics;
+
+            statistics.blockLevelCounts = blockTimesteps.GetLevelCounts();
+            statistics.blockEvaluationsPerParticle = blockTimesteps.GetEvaluationsPerParticle();
+            statistics.hermiteSubstepCount = hermiteIntegrator.GetSubstepCount();
+            statistics.regularizedPairCount = ksRegularization.GetPairCount();
+            statistics.ewaldCoefficient = particleMeshEwald.GetSplittingCoefficient();
+            statistics.nuclearCells = nuclearCellList.GetCellList().GetDimensions();
+            statistics.neighbourListSteps = nuclearNeighbourList.GetStepCount();
+            statistics.neighbourListRebuilds = nuclearNeighbourList.GetRebuildCount();
+            statistics.neighbourListLength = nuclearNeighbourList.GetAverageListLength();
+            statistics.coulombError = coulombError;
+
+            // Copy assignment reuses the capacity of the buffer, so this stops allocating after a few steps
+            publishedPhysicsState.WriteBuffer() = state;
+            publishedPhysicsState.Publish();
+        };
+
+        // Tiny atoms on the plain velocity Verlet path are stepped in batches from fixed size arrays,
+        // loaded again whenever the particles change or the path becomes eligible
+        SmallAtom smallAtom{ };
+        bool smallAtomLoaded = false;
+        bool smallAtomFits = true;
+
+        // Steps per batch with an unlimited step rate, adjusted so a batch takes a few milliseconds
+        int unlimitedBatchSize = 1;
+
+        // Fractional number of steps owed to the wall clock
+        double stepBacklog = 0.0;
+        auto lastPaceTime = std::chrono::steady_clock::now();
+
+        PhysicsCommand command{ };
+
+        while (!closePhysicsThread.load(std::memory_order_relaxed)) {
+            bool particlesChanged = false;
+
+            while (physicsCommands.TryPop(command)) {
+                switch (command.type) {
+                    case PhysicsCommandType::LoadScene:
+                        // Swap rather than move so both keep their capacity for the next load
+                        std::swap(state, command.scene);
+                        particlesChanged = true;
+                        break;
+
+                    case PhysicsCommandType::Clear:
+                        state.particles.Clear();
+                        state.periodic = false;
+                        particlesChanged = true;
+                        break;
+
+                    case PhysicsCommandType::SetTimeStep:
+                        physicsTimeStep = command.value;
+                        break;
+
+                    case PhysicsCommandType::SetStepRate:
+                        physicsStepsPerSecond = command.value;
+                        physicsUnlimitedStepRate = command.unlimited;
+                        break;
+
+                    case PhysicsCommandType::Pause:
+                        physicsPaused = true;
+                        singleSteps = 0;
+                        break;
+
+                    case PhysicsCommandType::Resume:
+                        physicsPaused = false;
+                        break;
+
+                    case PhysicsCommandType::SingleStep:
+                        if (physicsPaused) ++singleSteps;
+                        break;
+
+                    case PhysicsCommandType::AddParticle:
+                        AddParticle(state, command.species, command.position, command.velocity);
+                        particlesChanged = true;
+                        break;
+
+                    case PhysicsCommandType::RemoveParticle:
+                        if (command.index >= 0 && command.index < state.particles.Size()) {
+                            state.particles.Remove(command.index);
+                            particlesChanged = true;
+                        }
+                        break;
+
+                    case PhysicsCommandType::MeasureCoulombError:
+                        measureCoulombError = true;
+                        break;
                 }
             }
 
-            for (auto& c : state.pointCharges) {
-                c.position += c.velocity * dt;
+            // Settings the UI changed since the last step
+            if (publishedPhysicsSettings.Update()) {
+                settings = publishedPhysicsSettings.ReadBuffer();
+            }
+
+            if (particlesChanged) {
+                nuclearNeighbourList.Invalidate();
+                blockTimesteps.Invalidate();
+                hermiteIntegrator.Invalidate();
+                forcesValid = false;
+                smallAtomLoaded = false;
+                smallAtomFits = true;
+
+                // Shown straight away, even while paused
+                publishState();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            stepBacklog += std::chrono::duration<double>(now - lastPaceTime).count() * physicsStepsPerSecond;
+            lastPaceTime = now;
+
+            // A step that takes longer than the wall clock allows is not caught up on later, beyond the
+            // 10ms of steps a batch may take at once
+            stepBacklog = std::min(stepBacklog, std::max(2.0, physicsStepsPerSecond * 0.01));
+
+            int stepCount = 1;
+
+            if (physicsPaused) {
+                stepBacklog = 0.0;
+
+                if (singleSteps == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+
+                --singleSteps;
             }
+            else {
+                if (!physicsUnlimitedStepRate && stepBacklog < 1.0) {
+                    std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - stepBacklog) / physicsStepsPerSecond));
+                    continue;
+                }
+            }
+
+            const auto stepStart = std::chrono::steady_clock::now();
+            ProfileScope stepProfileScope{ "Step" };
 
-            for (int i = 0; i < state.nucleons.size(); ++i) {
-                for (int j = 0; j < state.nucleons.size(); ++j) {
-                    if (i == j) continue;
+            const std::uint64_t allocationsBefore = GetAllocationCount();
 
-                    PointCharge& n1 = state.nucleons[i];
-                    PointCharge& n2 = state.nucleons[j];
+            threadPool.Resize(settings.threadCount);
 
-                    float distance = glm::distance(n1.position, n2.position);
+            Particles& particles = state.particles;
+
+            const float dt = physicsTimeStep;
+
+            // Hermite has no periodic force sums, Verlet stands in for it in a box
+            IntegrationScheme scheme = settings.integrationScheme;
+            if (scheme == IntegrationScheme::Hermite && state.periodic) scheme = IntegrationScheme::VelocityVerlet;
+
+            const bool smallAtomEligible = settings.useSmallAtom && scheme == IntegrationScheme::VelocityVerlet && !settings.regularizeEncounters && !state.periodic
+                && settings.coulombSolver == CoulombSolver::Direct && settings.nuclearSolver == NuclearSolver::Direct;
+
+            if (smallAtomEligible && !smallAtomLoaded && smallAtomFits) {
+                smallAtomLoaded = smallAtom.Load(particles);
+                smallAtomFits = smallAtomLoaded;
+            }
+            else if (!smallAtomEligible && smallAtomLoaded) {
+                // The particles were stored after the last batch, only the general forces are stale
+                smallAtomLoaded = false;
+                forcesValid = false;
+            }
 
-                    // Using Yukawa Potential as an approximation:
-                    // U(r) = (e^(-r)) / r
-                    // -> F(r) = -(e^(-r) * r^(-1) + e^(-r) * r^(-2))
+            smallAtomActive.store(smallAtomLoaded, std::memory_order_relaxed);
 
-                    // Where r is the distance between the nucleons
+            // The general path takes one step per pass, the small atom path every step that is owed
+            if (!physicsPaused) {
+                if (!smallAtomLoaded) stepCount = 1;
+                else if (physicsUnlimitedStepRate) stepCount = unlimitedBatchSize;
+                else stepCount = std::max(1, (int)stepBacklog);
 
-                    // We then finally add 1 / r^(10) to the force to act as a repulsive core
-                    // here 10 is an arbitrary large number
+                stepBacklog = std::max(0.0, stepBacklog - stepCount);
+            }
 
-                    // F(r) = 1 / r^(10) -(e^(-r) * r^(-1) + e^(-r) * r^(-2))
+            if (smallAtomLoaded) {
+                {
+                    ProfileScope profileScope{ "Integrate" };
 
-                    float force = 1 / glm::pow(distance, 10.0f) - (glm::exp(distance) / (distance * distance) + (glm::exp(distance)) / (distance));
+                    smallAtom.Step(dt, stepCount);
+                    smallAtom.Store(particles);
+                }
 
-                    glm::vec3 direction = glm::normalize(n1.position - n2.position);
+                const std::chrono::duration<double> batchTime = std::chrono::steady_clock::now() - stepStart;
+                state.statistics.stepSeconds = batchTime.count() / stepCount;
 
-                    glm::vec3 accel = (force * direction) / n1.mass;
+                {
+                    ProfileScope profileScope{ "Publish" };
+                    publishState();
+                }
 
-                    n1.velocity += accel * dt;
+                if (physicsUnlimitedStepRate) {
+                    if (batchTime.count() < 0.001) unlimitedBatchSize = std::min(unlimitedBatchSize * 2, 1 << 20);
+                    else if (batchTime.count() > 0.004) unlimitedBatchSize = std::max(unlimitedBatchSize / 2, 1);
                 }
+
+                stepAllocations.store(GetAllocationCount() - allocationsBefore, std::memory_order_relaxed);
+                continue;
             }
 
-            for (auto& n : state.nucleons) {
-                n.position += n.velocity * dt;
+            // The schemes keep different parts of the force arrays up to date
+            if (!forcesValid || scheme != forcesScheme) {
+                computeForces(particles, state.periodic, state.boxSize);
+                hermiteIntegrator.Invalidate();
+                forcesValid = true;
+                forcesScheme = scheme;
+            }
+
+            {
+                ProfileScope profileScope{ "Integrate" };
+
+                if (scheme == IntegrationScheme::Hermite) {
+                    hermiteIntegrator.accuracy = settings.hermiteAccuracy;
+
+                    hermiteIntegrator.Step(particles, dt, threadPool);
+                }
+                else if (scheme == IntegrationScheme::BlockTimesteps) {
+                    blockTimesteps.maxLevel = settings.blockMaxLevel;
+                    blockTimesteps.accuracy = settings.blockAccuracy;
+
+                    blockTimesteps.Step(particles, dt, state.periodic, state.boxSize, forces, threadPool, [&](const int* targets, int targetCount) {
+                        computeForcesOn(particles, targets, targetCount, state.periodic, state.boxSize);
+                    });
+                }
+                else if (scheme == IntegrationScheme::Respa) {
+                    const int innerSteps = std::max(1, settings.respaInnerSteps);
+                    const float innerDt = dt / innerSteps;
+
+                    Kick(particles, 0, particles.Size(), coulombForces, 0.5f * dt, threadPool);
+
+                    for (int step = 0; step < innerSteps; ++step) {
+                        Kick(particles, 0, particles.Size(), nuclearForces, 0.5f * innerDt, threadPool);
+                        Drift(particles, 0, particles.Size(), innerDt, state.periodic, state.boxSize, threadPool);
+
+                        computeNuclearForces(particles, state.periodic, state.boxSize);
+
+                        Kick(particles, 0, particles.Size(), nuclearForces, 0.5f * innerDt, threadPool);
+                    }
+
+                    computeCoulombForces(particles, state.periodic, state.boxSize);
+
+                    Kick(particles, 0, particles.Size(), coulombForces, 0.5f * dt, threadPool);
+                }
+                else if (settings.regularizeEncounters && !state.periodic) {
+                    // Velocity Verlet with close electron-proton pairs drifting on their Kepler orbits
+                    ksRegularization.distance = settings.encounterDistance;
+                    ksRegularization.FindPairs(particles, threadPool);
+
+                    Kick(particles, 0, particles.Size(), ksRegularization.ExternalForces(particles, forces), 0.5f * dt, threadPool);
+                    ksRegularization.Drift(particles, dt, threadPool);
+
+                    computeForces(particles, state.periodic, state.boxSize);
+
+                    Kick(particles, 0, particles.Size(), ksRegularization.ExternalForces(particles, forces), 0.5f * dt, threadPool);
+                }
+                else {
+                    // Velocity Verlet, the forces at the end of the step carry over to the next one
+                    Kick(particles, 0, particles.Size(), forces, 0.5f * dt, threadPool);
+                    Drift(particles, 0, particles.Size(), dt, state.periodic, state.boxSize, threadPool);
+
+                    computeForces(particles, state.periodic, state.boxSize);
+
+                    Kick(particles, 0, particles.Size(), forces, 0.5f * dt, threadPool);
+                }
             }
 
-            ++mostRecentPhysicsState;
-            mostRecentPhysicsState %= physicsStateQueueSize;
-            physicsStateQueue[mostRecentPhysicsState] = state;
+            state.statistics.stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
 
-            dt = physicsTime.count() * timeMultiplier;
+            {
+                ProfileScope profileScope{ "Publish" };
+                publishState();
+            }
+
+            stepAllocations.store(GetAllocationCount() - allocationsBefore, std::memory_order_relaxed);
         }
     } };
 
+    Profiler::SetThreadName("Render");
+
+    // The profiler window's copy of the recent events, and the statistics it shows, which are only
+    // recomputed a few times a second
+    ProfileHistory profileHistory{ };
+    std::vector<std::vector<ProfileStatistics>> profileStatistics{ };
+    double profileStatisticsTime = 0.0;
+    bool profilerFrozen = false;
+    float profilerTimelineSpan = 20.0f;
+
+    // A capture started from the command line or the Profiler window, written out once it ends
+    ProfileCapture profileCapture{ };
+    bool profileCapturePending = false;
+    std::string profileCaptureStatus{ };
+
+    char tracePath[256] = "trace.json";
+
+    if (!traceOutput.empty()) {
+        traceOutput.copy(tracePath, sizeof(tracePath) - 1);
+        tracePath[std::min(traceOutput.size(), sizeof(tracePath) - 1)] = '\0';
+
+        profileCapture.duration = traceSeconds;
+        profileCapture.Start();
+        profileCapturePending = true;
+    }
+
+    std::vector<double> profilePlotXs{ };
+    std::vector<double> profilePlotYs{ };
+
+    // Each name keeps its colour from frame to frame
+    auto profileColor = [](const char* name) {
+        std::uint32_t hash = 2166136261u;
+
+        for (const char* c = name; *c; ++c) {
+            hash = (hash ^ (unsigned char)*c) * 16777619u;
+        }
+
+        return ImGui::GetColorU32(ImPlot::GetColormapColor((int)(hash % (std::uint32_t)ImPlot::GetColormapSize())));
+    };
+
     while (!glfwWindowShouldClose(window)) {
         TimeScope frameTimeScope{ &frameTime };
+        ProfileScope frameProfileScope{ "Frame" };
 
         glfwPollEvents();
 
@@ -454,8 +863,14 @@ int main() {
 
         {
             TimeScope renderingTimeScope{ &renderTime };
+            ProfileScope renderProfileScope{ "Render" };
 
-            PhysicsState physState = physicsStateQueue[mostRecentPhysicsState];
+            {
+                ProfileScope profileScope{ "Read State" };
+                publishedPhysicsState.Update();
+            }
+
+            const PhysicsState& physState = publishedPhysicsState.ReadBuffer();
 
             rendererTarget.Bind();
 
@@ -466,55 +881,61 @@ int main() {
             
             renderState.rects.clear();
 
-            for (const auto& pm : physState.pointMasses) {
-                Transform t{ pm.position, glm::vec3{ 0.6f } };
+            const Particles& particles = physState.particles;
 
-                Rect r{ t, glm::vec3{ 0.0f } };
-                renderState.rects.push_back(r);
-            }
+            {
+                ProfileScope profileScope{ "Build Rects" };
 
-            for (const auto& pc : physState.pointCharges) {
-                Transform t{ pc.position, glm::vec3{ 0.4f } };
+                for (int i = 0; i < particles.Size(); ++i) {
+                    float charge = particles.charge[i];
 
-                glm::vec3 color;
+                    glm::vec3 color;
+                    float size;
 
-                if (pc.charge > 0.0f) { color = glm::vec3{ 0.0f, 0.0f, 1.0f }; }
-                else { color = glm::vec3{ 1.0f, 0.0f, 0.0f }; }
-
-                Rect r{ t, color };
-                renderState.rects.push_back(r);
-            }
+                    if (particles.species[i] == Species::Electron) {
+                        size = 0.4f;
 
-            for (const auto& n : physState.nucleons) {
-                Transform t{ n.position, glm::vec3{ 0.5f } };
+                        if (charge > 0.0f) { color = glm::vec3{ 0.0f, 0.0f, 1.0f }; }
+                        else { color = glm::vec3{ 1.0f, 0.0f, 0.0f }; }
+                    }
+                    else {
+                        size = 0.5f;
 
-                glm::vec3 color;
+                        if (charge == 0.0f) { color = glm::vec3{ 1.0f, 1.0f, 1.0f }; }
+                        else if (charge > 0.0f) { color = glm::vec3{ 1.0f, 1.0f, 0.0f }; }
+                        else { color = glm::vec3{ 1.0f, 0.0f, 1.0f }; }
+                    }
 
-                if (n.charge == 0.0f) { color = glm::vec3{ 1.0f, 1.0f, 1.0f }; }
-                else if (n.charge > 0.0f) { color = glm::vec3{ 1.0f, 1.0f, 0.0f }; }
-                else { color = glm::vec3{ 1.0f, 0.0f, 1.0f }; }
+                    Transform t{ particles.Position(i), glm::vec3{ size } };
 
-                Rect r{ t, color };
-                renderState.rects.push_back(r);
+                    Rect r{ t, color };
+                    renderState.rects.push_back(r);
+                }
             }
 
-            for (auto& r : renderState.rects) {
-                solidShader.SetVec3("color", r.color);
+            {
+                ProfileScope profileScope{ "Draw" };
+
+                for (auto& r : renderState.rects) {
+                    solidShader.SetVec3("color", r.color);
 
-                glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)rendererTarget.GetSize().x / (float)rendererTarget.GetSize().y, camera.nearPlane, camera.farPlane);
+                    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), (float)rendererTarget.GetSize().x / (float)rendererTarget.GetSize().y, camera.nearPlane, camera.farPlane);
                 
-                r.transform.CalculateMatrix();
-                glm::mat4 mvp = projection * camera.View() * r.transform.matrix;
+                    r.transform.CalculateMatrix();
+                    glm::mat4 mvp = projection * camera.View() * r.transform.matrix;
 
-                solidShader.SetMat4("mvp", mvp);
+                    solidShader.SetMat4("mvp", mvp);
 
-                vao.Bind();
-                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+                    vao.Bind();
+                    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+                }
             }
 
             rendererTarget.Unbind();
         }
 
+        ProfileScope imguiProfileScope{ "ImGui" };
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -525,36 +946,584 @@ int main() {
         ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
 
         { ImGui::Begin("Scene");
+            // Solver statistics the physics thread published with the latest state
+            const PhysicsStatistics& statistics = publishedPhysicsState.ReadBuffer().statistics;
+
             float frameRate = 1.0f / frameTime.count();
-            float physicsFrameRate = 1.0f / physicsTime.count();
+            float physicsFrameRate = 1.0f / (float)statistics.stepSeconds;
 
             ImGui::Text("Total Framerate: %10.2f", frameRate);
             ImGui::Text("Physics Framerate: %10.2f", physicsFrameRate);
+            ImGui::Text("Heap Allocations Last Step: %llu", (unsigned long long)stepAllocations.load(std::memory_order_relaxed));
 
             ImGui::Separator();
 
-            ImGui::DragFloat("Time Multiplier", &timeMultiplier, 0.001f, 0.0000f, 1000.0f);
+            ImGui::DragFloat("Time Step", &timeStep, 0.00001f, 0.00001f, 0.1f, "%.5f");
+            ImGui::Checkbox("Unlimited Step Rate", &unlimitedStepRate);
+
+            if (!unlimitedStepRate) {
+                ImGui::DragFloat("Steps Per Second", &stepsPerSecond, 10.0f, 1.0f, 100000000.0f, "%.0f");
+                ImGui::Text("Simulated Time Per Second: %.4f", timeStep * glm::min(stepsPerSecond, physicsFrameRate));
+            }
+            else {
+                ImGui::Text("Simulated Time Per Second: %.4f", timeStep * physicsFrameRate);
+            }
+
+            if (timeStep != sentTimeStep && sendCommand(PhysicsCommand{ .type = PhysicsCommandType::SetTimeStep, .value = timeStep })) {
+                sentTimeStep = timeStep;
+            }
+
+            if ((stepsPerSecond != sentStepsPerSecond || unlimitedStepRate != sentUnlimitedStepRate)
+                && sendCommand(PhysicsCommand{ .type = PhysicsCommandType::SetStepRate, .value = stepsPerSecond, .unlimited = unlimitedStepRate })) {
+                sentStepsPerSecond = stepsPerSecond;
+                sentUnlimitedStepRate = unlimitedStepRate;
+            }
+
+            if (ImGui::Checkbox("Paused", &paused)) {
+                sendCommand(PhysicsCommand{ .type = paused ? PhysicsCommandType::Pause : PhysicsCommandType::Resume });
+            }
+
+            if (paused) {
+                ImGui::SameLine();
+
+                if (ImGui::Button("Step")) {
+                    sendCommand(PhysicsCommand{ .type = PhysicsCommandType::SingleStep });
+                }
+            }
+
+            const char* integrationSchemeNames[] = { "Velocity Verlet", "Block Time Steps", "RESPA", "Hermite" };
+            int selectedIntegrationScheme = (int)physicsSettings.integrationScheme;
+            if (ImGui::Combo("Integrator", &selectedIntegrationScheme, integrationSchemeNames, IM_ARRAYSIZE(integrationSchemeNames))) {
+                physicsSettings.integrationScheme = (IntegrationScheme)selectedIntegrationScheme;
+            }
+
+            if (physicsSettings.integrationScheme == IntegrationScheme::Respa) {
+                ImGui::SliderInt("Nuclear Steps Per Step", &physicsSettings.respaInnerSteps, 1, 64);
+                ImGui::Text("Nuclear Time Step: %.6f", timeStep / (float)physicsSettings.respaInnerSteps);
+            }
+
+            if (physicsSettings.integrationScheme == IntegrationScheme::VelocityVerlet && !physicsState.periodic) {
+                ImGui::Checkbox("Regularize Close Encounters", &physicsSettings.regularizeEncounters);
+
+                if (physicsSettings.regularizeEncounters) {
+                    ImGui::SliderFloat("Encounter Distance", &physicsSettings.encounterDistance, 0.05f, 3.0f);
+                    ImGui::Text("Regularized Pairs: %d", statistics.regularizedPairCount);
+                }
+
+                ImGui::Checkbox("Small Atom Fast Path", &physicsSettings.useSmallAtom);
+                ImGui::Text("Small Atom Fast Path: %s", smallAtomActive.load(std::memory_order_relaxed) ? "Active" : "Inactive");
+            }
+
+            if (physicsSettings.integrationScheme == IntegrationScheme::Hermite) {
+                ImGui::DragFloat("Step Accuracy", &physicsSettings.hermiteAccuracy, 0.001f, 0.0f, 1.0f, "%.3f");
+                ImGui::Text("Force Evaluations Per Step: %d", statistics.hermiteSubstepCount);
+
+                if (physicsState.periodic) {
+                    ImGui::Text("Hermite needs an open box, using Velocity Verlet");
+                }
+            }
+
+            if (physicsSettings.integrationScheme == IntegrationScheme::BlockTimesteps) {
+                ImGui::SliderInt("Max Level", &physicsSettings.blockMaxLevel, 0, 16);
+                ImGui::DragFloat("Step Accuracy", &physicsSettings.blockAccuracy, 0.0005f, 0.0005f, 1.0f, "%.4f");
+
+                for (int level = 0; level < (int)statistics.blockLevelCounts.size(); ++level) {
+                    int count = statistics.blockLevelCounts[level];
+
+                    if (count > 0) {
+                        ImGui::Text("Level %d (dt %.2e): %d particles", level, timeStep / (float)(1 << level), count);
+                    }
+                }
+
+                ImGui::Text("Force Evaluations Per Particle Per Step: %.2f", statistics.blockEvaluationsPerParticle);
+            }
+
+            ImGui::SliderInt("Physics Threads", &physicsSettings.threadCount, 1, (int)std::thread::hardware_concurrency());
+
+            if (ImGui::BeginCombo("Pair Kernels", SimdLevelName(physicsSettings.simdLevel))) {
+                for (int level = 0; level <= (int)supportedSimdLevel; ++level) {
+                    if (ImGui::Selectable(SimdLevelName((SimdLevel)level), level == (int)physicsSettings.simdLevel)) {
+                        physicsSettings.simdLevel = (SimdLevel)level;
+                    }
+                }
+
+                ImGui::EndCombo();
+            }
 
             ImGui::Separator();
 
-            ImGui::DragInt("Protons", &newSceneProtonCount, 0.1f, 0, 100);
-            ImGui::DragInt("Neutrons", &newSceneNeutronCount, 0.1f, 0, 100);
-            ImGui::DragInt("Electrons", &newSceneElectronCount, 0.1f, 0, 100);
+            if (physicsState.periodic) {
+                ImGui::Text("Coulomb Solver: Particle Mesh Ewald");
+
+                ImGui::SliderFloat("Real Space Cutoff", &physicsSettings.ewaldCutoff, 0.5f, 0.5f * physicsState.boxSize);
+                ImGui::SliderInt("Mesh Size", &physicsSettings.ewaldMeshSize, 4, 128);
+                ImGui::SliderInt("Spline Order", &physicsSettings.ewaldSplineOrder, 3, 8);
+
+                ImGui::Text("Ewald Coefficient: %.4f", statistics.ewaldCoefficient);
+            }
+            else {
+                const char* coulombSolverNames[] = { "Direct", "Barnes-Hut", "Fast Multipole" };
+                int selectedCoulombSolver = (int)physicsSettings.coulombSolver;
+                if (ImGui::Combo("Coulomb Solver", &selectedCoulombSolver, coulombSolverNames, IM_ARRAYSIZE(coulombSolverNames))) {
+                    physicsSettings.coulombSolver = (CoulombSolver)selectedCoulombSolver;
+                }
+            }
+
+            if (!physicsState.periodic && physicsSettings.coulombSolver == CoulombSolver::BarnesHut) {
+                ImGui::SliderFloat("Opening Angle", &physicsSettings.barnesHutTheta, 0.0f, 1.5f);
+            }
+
+            if (!physicsState.periodic && physicsSettings.coulombSolver == CoulombSolver::FastMultipole) {
+                ImGui::SliderInt("Expansion Order", &physicsSettings.fastMultipoleOrder, 1, 16);
+                ImGui::SliderFloat("Acceptance Angle", &physicsSettings.fastMultipoleTheta, 0.1f, 1.0f);
+                ImGui::SliderInt("Leaf Capacity", &physicsSettings.fastMultipoleLeafCapacity, 1, 256);
+            }
+
+            if (!physicsState.periodic && physicsSettings.coulombSolver != CoulombSolver::Direct) {
+                if (ImGui::Button("Measure Error")) {
+                    sendCommand(PhysicsCommand{ .type = PhysicsCommandType::MeasureCoulombError });
+                }
+
+                ImGui::SameLine();
+                ImGui::Text("Relative Force Error: %.3e", statistics.coulombError);
+            }
+
+            ImGui::Separator();
+
+            const char* nuclearSolverNames[] = { "All Pairs", "Cell List", "Neighbour List" };
+            int selectedNuclearSolver = (int)physicsSettings.nuclearSolver;
+            if (ImGui::Combo("Nuclear Pairs", &selectedNuclearSolver, nuclearSolverNames, IM_ARRAYSIZE(nuclearSolverNames))) {
+                physicsSettings.nuclearSolver = (NuclearSolver)selectedNuclearSolver;
+            }
+
+            if (physicsSettings.nuclearSolver != NuclearSolver::Direct) {
+                ImGui::SliderFloat("Cutoff Radius", &physicsSettings.nuclearCutoff, 1.0f, 20.0f);
+            }
+
+            if (physicsSettings.nuclearSolver == NuclearSolver::CellList) {
+                ImGui::SliderFloat("Cell Size", &physicsSettings.nuclearCellSize, 1.0f, 20.0f);
+
+                glm::ivec3 cells = statistics.nuclearCells;
+                ImGui::Text("Cells: %d x %d x %d", cells.x, cells.y, cells.z);
+            }
+
+            if (physicsSettings.nuclearSolver == NuclearSolver::NeighbourList) {
+                ImGui::SliderFloat("Skin", &physicsSettings.nuclearSkin, 0.0f, 5.0f);
+
+                int steps = statistics.neighbourListSteps;
+                int rebuilds = statistics.neighbourListRebuilds;
+
+                ImGui::Text("List Rebuilds: %d in %d steps (every %.1f steps)", rebuilds, steps, rebuilds > 0 ? (float)steps / rebuilds : 0.0f);
+                ImGui::Text("Average List Length: %.1f", statistics.neighbourListLength);
+            }
+
+            ImGui::Separator();
+
+            ImGui::DragInt("Protons", &newSceneProtonCount, 0.1f, 0, 100000);
+            ImGui::DragInt("Neutrons", &newSceneNeutronCount, 0.1f, 0, 100000);
+            ImGui::DragInt("Electrons", &newSceneElectronCount, 0.1f, 0, 100000);
+
+            ImGui::Checkbox("Periodic Box", &newScenePeriodic);
+
+            if (newScenePeriodic) {
+                ImGui::DragFloat("Box Size", &newSceneBoxSize, 0.1f, 1.0f, 1000.0f);
+            }
 
             if (ImGui::Button("Clear")) {
                 physicsState = PhysicsState{ };
-                reloadScene = true;
+                sendCommand(PhysicsCommand{ .type = PhysicsCommandType::Clear });
             }
 
             ImGui::SameLine();
 
             if (ImGui::Button("Load")) {
                 physicsState = PhysicsState{ };
-                AddToState(newSceneNeutronCount, newSceneProtonCount, newSceneElectronCount);
-                reloadScene = true;
+                AddToState(physicsState, newSceneNeutronCount, newSceneProtonCount, newSceneElectronCount);
+
+                // The box is never smaller than the lattice so no two particles start on the same site
+                physicsState.periodic = newScenePeriodic;
+                physicsState.boxSize = glm::max(newSceneBoxSize, (float)LatticeSize(newSceneNeutronCount + newSceneProtonCount + newSceneElectronCount));
+
+                sendCommand(PhysicsCommand{ .type = PhysicsCommandType::LoadScene, .scene = physicsState });
+            }
+
+            ImGui::Separator();
+
+            const char* speciesNames[] = { "Electron", "Proton", "Neutron" };
+            int selectedSpecies = (int)newParticleSpecies;
+            if (ImGui::Combo("Species", &selectedSpecies, speciesNames, IM_ARRAYSIZE(speciesNames))) {
+                newParticleSpecies = (Species)selectedSpecies;
+            }
+
+            ImGui::DragFloat3("Position", &newParticlePosition.x, 0.1f);
+            ImGui::DragFloat3("Velocity", &newParticleVelocity.x, 0.1f);
+
+            if (ImGui::Button("Add Particle")) {
+                sendCommand(PhysicsCommand{ .type = PhysicsCommandType::AddParticle, .species = newParticleSpecies, .position = newParticlePosition, .velocity = newParticleVelocity });
+            }
+
+            ImGui::DragInt("Particle Index", &removeParticleIndex, 0.1f, 0, 100000);
+
+            if (ImGui::Button("Remove Particle")) {
+                sendCommand(PhysicsCommand{ .type = PhysicsCommandType::RemoveParticle, .index = removeParticleIndex });
             }
         } ImGui::End();
 
+        // The physics thread takes the newest settings before its next step
+        publishedPhysicsSettings.WriteBuffer() = physicsSettings;
+        publishedPhysicsSettings.Publish();
+
+        { ImGui::Begin("Ensemble");
+            const bool running = ensembleRunning.load(std::memory_order_acquire);
+
+            if (!running && ensembleThread.joinable()) {
+                ensembleThread.join();
+
+                ensembleStatistics = ensemble.GetStatistics();
+                ensembleFinished = true;
+            }
+
+            ImGui::BeginDisabled(running);
+
+            ImGui::InputInt("Protons", &ensemble.protonCount);
+            ImGui::InputInt("Neutrons", &ensemble.neutronCount);
+            ImGui::InputInt("Electrons", &ensemble.electronCount);
+            ImGui::InputInt("Replicas", &ensemble.replicaCount);
+            ImGui::InputScalar("Seed", ImGuiDataType_U64, &ensemble.seed);
+            ImGui::DragFloat("Position Jitter", &ensemble.positionJitter, 0.001f, 0.0f, 1.0f);
+            ImGui::DragFloat("Velocity Jitter", &ensemble.velocityJitter, 0.001f, 0.0f, 1.0f);
+            ImGui::DragFloat("Time Step", &ensemble.timeStep, 0.00001f, 0.00001f, 0.1f, "%.5f");
+            ImGui::InputInt("Steps", &ensemble.stepCount);
+            ImGui::InputInt("Steps Between Checks", &ensemble.checkInterval);
+            ImGui::DragFloat("Escape Distance", &ensemble.escapeDistance, 0.1f, 1.0f, 1000.0f);
+            ImGui::Checkbox("One Replica Per Vector Lane", &ensemble.batchReplicas);
+
+            // The ensemble thread reads these during a run, they are only written while it is idle
+            if (!running) {
+                ensemble.protonCount = std::max(ensemble.protonCount, 0);
+                ensemble.neutronCount = std::max(ensemble.neutronCount, 0);
+                ensemble.electronCount = std::max(ensemble.electronCount, 0);
+                ensemble.replicaCount = std::max(ensemble.replicaCount, 1);
+                ensemble.stepCount = std::max(ensemble.stepCount, 1);
+                ensemble.checkInterval = std::max(ensemble.checkInterval, 1);
+            }
+
+            if (ImGui::Button("Run")) {
+                ensemble.simdLevel = physicsSettings.simdLevel;
+                ensembleRunning.store(true, std::memory_order_relaxed);
+                ensemble.Reset();
+
+                ensembleThread = std::thread{ [&]() {
+                    ThreadPool pool{ (int)std::thread::hardware_concurrency() };
+                    ensemble.Run(pool);
+
+                    ensembleRunning.store(false, std::memory_order_release);
+                } };
+            }
+
+            ImGui::EndDisabled();
+
+            if (running) {
+                ImGui::ProgressBar((float)ensemble.GetCompletedCount() / (float)ensemble.replicaCount);
+
+                if (ImGui::Button("Cancel")) {
+                    ensemble.Cancel();
+                }
+            }
+            else if (ensembleFinished) {
+                ImGui::Separator();
+
+                ImGui::Text("Replicas: %d", ensembleStatistics.replicaCount);
+                ImGui::Text("Ionized: %.1f%%", 100.0f * ensembleStatistics.ionizedFraction);
+                ImGui::Text("Electron Escape Time: mean %.4f, median %.4f", ensembleStatistics.meanElectronEscapeTime, ensembleStatistics.medianElectronEscapeTime);
+                ImGui::Text("Nucleus Broken: %.1f%%", 100.0f * ensembleStatistics.brokenFraction);
+                ImGui::Text("Nucleon Escape Time: mean %.4f", ensembleStatistics.meanNucleonEscapeTime);
+                ImGui::Text("Relative Energy Drift: mean %.3e, max %.3e", ensembleStatistics.meanEnergyDrift, ensembleStatistics.maxEnergyDrift);
+                ImGui::Text("Replica Steps Per Second: %.0f", ensembleStatistics.stepsPerSecond);
+            }
+        } ImGui::End(); // Ensemble
+
+        profileCapture.Update();
+
+        if (profileCapturePending && !profileCapture.IsCapturing()) {
+            profileCapturePending = false;
+
+            if (profileCapture.WriteChromeTrace(tracePath)) {
+                profileCaptureStatus = "Wrote " + std::to_string(profileCapture.GetEventCount()) + " scopes to " + tracePath
+                    + ", " + std::to_string(profileCapture.GetDroppedCount()) + " dropped";
+            }
+            else {
+                profileCaptureStatus = std::string{ "Could not write " } + tracePath;
+            }
+        }
+
+        { ImGui::Begin("Profiler");
+            bool profilerEnabled = Profiler::enabled.load(std::memory_order_relaxed);
+
+            ImGui::BeginDisabled(profileCapture.IsCapturing());
+
+            if (ImGui::Checkbox("Enabled", &profilerEnabled)) {
+                Profiler::enabled.store(profilerEnabled, std::memory_order_relaxed);
+            }
+
+            ImGui::EndDisabled();
+
+            ImGui::SameLine();
+
+            bool countersEnabled = Profiler::countersEnabled.load(std::memory_order_relaxed);
+
+            if (ImGui::Checkbox("Hardware Counters", &countersEnabled)) {
+                Profiler::countersEnabled.store(countersEnabled, std::memory_order_relaxed);
+            }
+
+            ImGui::SameLine();
+            ImGui::Checkbox("Freeze", &profilerFrozen);
+
+            ImGui::SameLine();
+
+            if (ImGui::Button("Clear")) {
+                profileHistory.Clear();
+                profileStatistics.clear();
+            }
+
+            ImGui::BeginDisabled(profileCapture.IsCapturing());
+
+            ImGui::InputText("Trace File", tracePath, sizeof(tracePath));
+            ImGui::DragFloat("Trace Seconds", &traceSeconds, 0.1f, 0.1f, 60.0f, "%.1f");
+
+            ImGui::EndDisabled();
+
+            if (!profileCapture.IsCapturing()) {
+                if (ImGui::Button("Capture Trace")) {
+                    profileCapture.duration = traceSeconds;
+                    profileCapture.Start();
+                    profileCapturePending = true;
+                }
+            }
+            else {
+                ImGui::ProgressBar((float)(profileCapture.GetCapturedTime() / profileCapture.duration), ImVec2{ -100.0f, 0.0f });
+                ImGui::SameLine();
+
+                if (ImGui::Button("Stop")) {
+                    profileCapture.Stop();
+                }
+            }
+
+            if (!profileCaptureStatus.empty()) {
+                ImGui::Text("%s", profileCaptureStatus.c_str());
+            }
+
+            ImGui::Separator();
+
+            ImGui::SliderFloat("Timeline (ms)", &profilerTimelineSpan, 0.01f, 2000.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+
+            if (!profilerFrozen) profileHistory.Update();
+
+            const std::vector<ProfileHistory::Thread>& profileThreads = profileHistory.GetThreads();
+            const double latestTick = (double)profileHistory.GetLatestTick();
+            const double millisecondsPerTick = Profiler::NanosecondsPerTick() * 1.0e-6;
+
+            if (!profilerFrozen && glfwGetTime() - profileStatisticsTime > 0.25) {
+                profileStatisticsTime = glfwGetTime();
+                profileStatistics.clear();
+
+                for (const ProfileHistory::Thread& thread : profileThreads) {
+                    profileStatistics.push_back(ComputeProfileStatistics(thread.events));
+                }
+            }
+
+            // A row per depth of each thread that has recorded anything, threads one under the other
+            std::vector<int> rowBegins{ };
+            std::vector<double> labelRows{ };
+            std::vector<const char*> labels{ };
+            int rowCount = 0;
+
+            for (const ProfileHistory::Thread& thread : profileThreads) {
+                if (thread.events.empty()) {
+                    rowBegins.push_back(-1);
+                    continue;
+                }
+
+                int maxDepth = 0;
+                for (const ProfileEvent& event : thread.events) maxDepth = std::max(maxDepth, event.depth);
+
+                const char* name = thread.thread->GetName();
+
+                rowBegins.push_back(rowCount);
+                labelRows.push_back(rowCount + 0.45);
+                labels.push_back(name ? name : "Unnamed");
+
+                rowCount += maxDepth + 1;
+            }
+
+            if (ImPlot::BeginPlot("##Timeline", ImVec2{ -1.0f, 80.0f + 22.0f * rowCount }, ImPlotFlags_NoLegend | ImPlotFlags_NoMenus | ImPlotFlags_NoBoxSelect)) {
+                ImPlot::SetupAxes("Milliseconds", nullptr, 0, ImPlotAxisFlags_Invert | ImPlotAxisFlags_Lock | ImPlotAxisFlags_NoGridLines);
+
+                // Follows the newest events, and can be panned and zoomed once frozen
+                ImPlot::SetupAxisLimits(ImAxis_X1, -profilerTimelineSpan, 0.0, profilerFrozen ? ImPlotCond_Once : ImPlotCond_Always);
+                ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, std::max(rowCount, 1), ImPlotCond_Always);
+
+                if (!labels.empty()) {
+                    ImPlot::SetupAxisTicks(ImAxis_Y1, labelRows.data(), (int)labels.size(), labels.data());
+                }
+
+                const ImPlotRect limits = ImPlot::GetPlotLimits();
+                const ImPlotPoint mouse = ImPlot::GetPlotMousePos();
+                const bool hovered = ImPlot::IsPlotHovered();
+
+                ImDrawList* drawList = ImPlot::GetPlotDrawList();
+                ImPlot::PushPlotClipRect();
+
+                for (size_t t = 0; t < profileThreads.size(); ++t) {
+                    if (rowBegins[t] < 0) continue;
+
+                    for (const ProfileEvent& event : profileThreads[t].events) {
+                        const double begin = ((double)event.begin - latestTick) * millisecondsPerTick;
+                        const double end = ((double)event.end - latestTick) * millisecondsPerTick;
+
+                        if (end < limits.X.Min || begin > limits.X.Max) continue;
+
+                        const double top = rowBegins[t] + event.depth;
+
+                        ImVec2 topLeft = ImPlot::PlotToPixels(begin, top);
+                        ImVec2 bottomRight = ImPlot::PlotToPixels(end, top + 0.9);
+
+                        // Scopes too short to see are still drawn a pixel wide
+                        bottomRight.x = std::max(bottomRight.x, topLeft.x + 1.0f);
+
+                        drawList->AddRectFilled(topLeft, bottomRight, profileColor(event.name));
+
+                        if (bottomRight.x - topLeft.x > ImGui::CalcTextSize(event.name).x + 4.0f) {
+                            drawList->AddText(ImVec2{ topLeft.x + 2.0f, topLeft.y + 1.0f }, IM_COL32_BLACK, event.name);
+                        }
+
+                        if (hovered && mouse.x >= begin && mouse.x <= end && mouse.y >= top && mouse.y <= top + 0.9) {
+                            ImGui::SetTooltip("%s\n%.3f us", event.name, (end - begin) * 1000.0);
+                        }
+                    }
+                }
+
+                ImPlot::PopPlotClipRect();
+                ImPlot::EndPlot();
+            }
+
+            // Durations of the outermost scopes, so a step or a frame that stands out can be found
+            if (ImPlot::BeginPlot("##History", ImVec2{ -1.0f, 200.0f }, ImPlotFlags_NoMenus | ImPlotFlags_NoBoxSelect)) {
+                ImPlot::SetupAxes("Seconds", "Microseconds", 0, ImPlotAxisFlags_AutoFit);
+                ImPlot::SetupAxisLimits(ImAxis_X1, -profileHistory.length, 0.0, ImPlotCond_Always);
+
+                for (size_t t = 0; t < profileThreads.size(); ++t) {
+                    if (rowBegins[t] < 0) continue;
+
+                    const std::vector<ProfileEvent>& events = profileThreads[t].events;
+
+                    // At most a few thousand points, ImPlot slows down long before the physics thread does
+                    const size_t stride = events.size() / 4096 + 1;
+
+                    profilePlotXs.clear();
+                    profilePlotYs.clear();
+
+                    for (size_t i = 0; i < events.size(); i += stride) {
+                        if (events[i].depth != 0) continue;
+
+                        profilePlotXs.push_back(((double)events[i].end - latestTick) * millisecondsPerTick * 1.0e-3);
+                        profilePlotYs.push_back((double)(events[i].end - events[i].begin) * millisecondsPerTick * 1.0e3);
+                    }
+
+                    const char* name = profileThreads[t].thread->GetName();
+                    ImPlot::PlotLine(name ? name : "Unnamed", profilePlotXs.data(), profilePlotYs.data(), (int)profilePlotXs.size());
+                }
+
+                ImPlot::EndPlot();
+            }
+
+            // Counts per call of the scopes that read the hardware counters, only shown once some have
+            bool counted = false;
+
+            for (const std::vector<ProfileStatistics>& threadStatistics : profileStatistics) {
+                for (const ProfileStatistics& statistics : threadStatistics) {
+                    counted = counted || statistics.countedCount > 0;
+                }
+            }
+
+            if (countersEnabled && !counted && profilerEnabled) {
+                ImGui::TextDisabled("No hardware counters, perf_event_open is unavailable or not permitted");
+            }
+
+            if (ImGui::BeginTable("Profile Statistics", counted ? 11 : 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+                ImGui::TableSetupColumn("Scope");
+                ImGui::TableSetupColumn("Calls");
+                ImGui::TableSetupColumn("Min (us)");
+                ImGui::TableSetupColumn("Avg (us)");
+                ImGui::TableSetupColumn("P99 (us)");
+                ImGui::TableSetupColumn("Max (us)");
+
+                if (counted) {
+                    ImGui::TableSetupColumn("Cycles");
+                    ImGui::TableSetupColumn("IPC");
+                    ImGui::TableSetupColumn("L1D Misses");
+                    ImGui::TableSetupColumn("LLC Misses");
+                    ImGui::TableSetupColumn("Branch Misses");
+                }
+
+                ImGui::TableHeadersRow();
+
+                for (size_t t = 0; t < profileStatistics.size(); ++t) {
+                    if (profileStatistics[t].empty()) continue;
+
+                    const char* name = profileThreads[t].thread->GetName();
+
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextDisabled("%s", name ? name : "Unnamed");
+
+                    for (const ProfileStatistics& statistics : profileStatistics[t]) {
+                        ImGui::TableNextRow();
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%*s%s", 2 * (statistics.depth + 1), "", statistics.name);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%d", statistics.count);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", statistics.minimum);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", statistics.average);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", statistics.p99);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", statistics.maximum);
+
+                        if (counted && statistics.countedCount > 0) {
+                            const double cycles = statistics.counts[(int)PerfCounter::Cycles];
+                            const double instructions = statistics.counts[(int)PerfCounter::Instructions];
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.0f", cycles);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.2f", cycles > 0.0 ? instructions / cycles : 0.0);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", statistics.counts[(int)PerfCounter::L1DataMisses]);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", statistics.counts[(int)PerfCounter::LastLevelMisses]);
+
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%.1f", statistics.counts[(int)PerfCounter::BranchMisses]);
+                        }
+                    }
+                }
+
+                ImGui::EndTable();
+            }
+        } ImGui::End(); // Profiler
+
         glm::ivec2 newViewportSize{ };
 
         { ImGui::Begin("Viewport");
@@ -582,6 +1551,8 @@ int main() {
             glfwMakeContextCurrent(currentContextBackup);
         }
 
+        imguiProfileScope.End();
+
         // After ImGui has rendered its frame, we resize the framebuffer if needed for next frame
         if (newViewportSize != lastFrameViewportSize) {
             rendererTarget.Resize(newViewportSize);
@@ -589,12 +1560,20 @@ int main() {
 
         lastFrameViewportSize = newViewportSize;
 
-        glfwSwapBuffers(window);
+        {
+            ProfileScope profileScope{ "Swap Buffers" };
+            glfwSwapBuffers(window);
+        }
     }
 
-    closePhysicsThread = true;
+    closePhysicsThread.store(true, std::memory_order_relaxed);
     physicsThread.join();
 
+    if (ensembleThread.joinable()) {
+        ensemble.Cancel();
+        ensembleThread.join();
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImPlot::DestroyContext();